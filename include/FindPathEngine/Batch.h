@@ -0,0 +1,113 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace fpe
+{
+	/** This is a group of find path requests that are processed together.
+	* Use it when there are thousands of requests at a time: the requests are split in chunks,
+	* each chunk is a single job for the threads pool, and all the paths are written in one buffer.
+	* The results are stored as arrays (structure of arrays): the path of the request i is
+	* GetPathNodes()[GetOffsets()[i]] ... GetPathNodes()[GetOffsets()[i] + GetLengths()[i] - 1],
+	* from start to goal.
+	* How to use it:
+	* // ------------------
+	* std::shared_ptr<fpe::Batch> batch = engine->AddBatch(starts, goals);
+	*
+	* batch->Wait(); // or check batch->IsDone() each frame
+	*
+	* for (unsigned int i = 0; i < batch->GetCount(); i++)
+	* {
+	*   if (batch->GetStatuses()[i] == fpe::Batch::Status::FOUND) ...
+	* }
+	* // ------------------*/
+	class Batch
+	{
+		friend class FindPathEngine;
+	public:
+		/** The constructor. Use FindPathEngine::AddBatch() to create a batch.
+		* @param startIndexes are the start nodes.
+		* @param goalIndexes are the target nodes. Must have the same size as startIndexes.
+		* @param chunkSize is how many requests are processed by a job.*/
+		Batch(const std::vector<unsigned int>& startIndexes, const std::vector<unsigned int>& goalIndexes, unsigned int chunkSize);
+
+		/** Used to describe the result of each request.*/
+		enum class Status : unsigned char
+		{
+			/** The request was not processed yet.*/
+			WAITING = 0,
+
+			/** The path was found.*/
+			FOUND,
+
+			/** There is no path to goal.*/
+			NOT_FOUND,
+
+			/** The request was not processed because the batch was stopped.*/
+			STOPPED,
+		};
+
+		/** Return true if all the requests were processed. */
+		bool IsDone() { return m_done; }
+
+		/** Block the caller until all the requests are processed.*/
+		void Wait();
+
+		/** Use this function to stop the batch. The requests not processed yet will have the STOPPED status.*/
+		void Stop();
+
+		/** Getter for the number of requests */
+		unsigned int GetCount() { return (unsigned int)m_startIndexes.size(); }
+
+		/** Getters for the results. Use them only after the batch is done.*/
+		const std::vector<unsigned int>& GetPathNodes() { return m_pathNodes; }
+		const std::vector<unsigned int>& GetOffsets() { return m_offsets; }
+		const std::vector<unsigned int>& GetLengths() { return m_lengths; }
+		const std::vector<Status>& GetStatuses() { return m_statuses; }
+
+	private:
+
+		/** The requests */
+		std::vector<unsigned int> m_startIndexes;
+		std::vector<unsigned int> m_goalIndexes;
+
+		unsigned int m_chunkSize;
+
+		/** The paths of each chunk are written here, then each chunk is copied in m_pathNodes by its own job,
+		* after all the chunks are processed. The offsets of a chunk are relative to its buffer until then.*/
+		std::vector<std::vector<unsigned int> > m_chunkNodes;
+
+		/** All the paths, one after another */
+		std::vector<unsigned int> m_pathNodes;
+
+		/** Where each path starts in m_pathNodes */
+		std::vector<unsigned int> m_offsets;
+
+		/** How many nodes each path have */
+		std::vector<unsigned int> m_lengths;
+
+		std::vector<Status> m_statuses;
+
+		/** How many chunks are not processed yet */
+		std::atomic<unsigned int> m_pendingChunks;
+
+		/** How many chunks are not copied in m_pathNodes yet */
+		std::atomic<unsigned int> m_pendingMerges;
+
+		std::atomic<bool> m_mustStop;
+
+		std::atomic<bool> m_done;
+
+		/** Used by Wait() */
+		std::mutex m_doneMutex;
+		std::condition_variable m_doneCondition;
+	};
+
+} // namespace fpe
+
+#endif //BATCH_H
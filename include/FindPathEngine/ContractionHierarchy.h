@@ -0,0 +1,107 @@
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include <vector>
+
+
+/// forward declaration for ThreadPool
+namespace tp
+{
+	class ThreadPool;
+}
+
+namespace fpe
+{
+	/** Forward declaration. */
+	class StaticGraph;
+
+	/** This class implements the Contraction Hierarchies speed-up technique.
+	* In the preprocessing stage the nodes are ordered by importance and contracted one
+	* by one (removed from the graph); shortcut edges are added where the removed node was part
+	* of a shortest path. A query is then a bidirectional Dijkstra that goes only "upward" (to more
+	* important nodes), so it visits only a few hundred nodes even on very big graphs.
+	* The hierarchy is valid only while the navmesh does not change (the costs and the neighbors).
+	* How to use it:
+	* // ------------------
+	* std::shared_ptr<fpe::ContractionHierarchy> hierarchy = engine->ComputeContractionHierarchy(NavMesh::k_meshSize);
+	* engine->SetContractionHierarchy(hierarchy);
+	* /// From now on the tickets are solved with a single query.
+	* // ------------------*/
+	class ContractionHierarchy
+	{
+	public:
+
+		/** This value is used for the original edges, that are not shortcuts.*/
+		static const unsigned int k_noMiddle = 0xFFFFFFFF;
+
+		/** The constructor. The hierarchy is empty until Build() is called.*/
+		ContractionHierarchy();
+
+		/** Order the nodes and contract them. The contraction is done in rounds: each round the nodes that
+		* are less important than all the nodes at one or two edges from them are contracted in parallel on the threads pool.
+		* This function is blockant.
+		* @param graph is the snapshot of the navmesh.
+		* @param threadsPool is the pool used for the contraction. Can be null, then all runs on the caller thread.*/
+		void Build(const StaticGraph& graph, tp::ThreadPool* threadsPool);
+
+		/** Find the shortest path between two nodes. This function can be called from many threads at a time.
+		* @param startIndex is the start node.
+		* @param goalIndex is the target node.
+		* @param path is filled with the nodes of the path, in the same order as Ticket::GetFoundPath()
+		*        (the goal is the first one and the start is the last one).
+		* @param cost is set to the cost of the path.
+		* @return false if there is no path.*/
+		bool FindPath(unsigned int startIndex, unsigned int goalIndex, std::vector<unsigned int>& path, int& cost) const;
+
+		/** Getter for the number of nodes */
+		unsigned int GetNodesCount() const { return m_nodesCount; }
+
+		/** Getter for the number of shortcuts added by Build() */
+		unsigned int GetShortcutsCount() const { return m_shortcutsCount; }
+
+	private:
+
+		/** Find the middle node of the edge between two nodes. The edge must exist.
+		* The nodes and the middle are ids, see m_ids.*/
+		unsigned int GetEdgeMiddle(unsigned int fromIndex, unsigned int toIndex) const;
+
+		/** Replace the edge with the original edges. The nodes are ids, see m_ids.
+		* @param path is the list where the nodes are added, after fromIndex and up to toIndex.*/
+		void UnpackEdge(unsigned int fromIndex, unsigned int toIndex, unsigned int middle, std::vector<unsigned int>& path) const;
+
+		/** How many nodes are in the hierarchy */
+		unsigned int m_nodesCount;
+
+		/** How many shortcuts were added */
+		unsigned int m_shortcutsCount;
+
+		/** The edges are stored by id, not by node index. The ids are given in the reverse order of
+		* contraction: the most important node have the id 0, so an edge goes up if it goes to a smaller id.*/
+		std::vector<unsigned int> m_ids;
+
+		/** The node index of each id */
+		std::vector<unsigned int> m_nodes;
+
+		/** This is an edge read by the queries. The other node and the cost are together, because
+		* the search reads them together. The middles are apart, only the unpacking reads them.*/
+		struct QueryEdge
+		{
+			unsigned int m_node;
+			int m_cost;
+		};
+
+		/** The edges from a node to the nodes with a bigger rank. The edges of the id are
+		* between m_upOffsets[id] and m_upOffsets[id + 1].*/
+		std::vector<unsigned int> m_upOffsets;
+		std::vector<QueryEdge> m_upEdges;
+		std::vector<unsigned int> m_upMiddles;
+
+		/** The edges that come to a node from the nodes with a bigger rank. Used by the backward search.*/
+		std::vector<unsigned int> m_downOffsets;
+		std::vector<QueryEdge> m_downEdges;
+		std::vector<unsigned int> m_downMiddles;
+	};
+
+} // namespace fpe
+
+#endif //CONTRACTIONHIERARCHY_H
@@ -45,11 +45,31 @@ namespace fpe
 		* @param nodeIndex is the node that you want to get the neighbors for.
 		* @return a list with neighbor nodes Indexes.*/
 		virtual std::vector<unsigned int> GetNeighbors(unsigned int nodeIndex) = 0;
+
+		/** Optional, used only by the tickets with post process (see Ticket::SetPostProcess()).
+		* Tell if an agent can move in a straight line between two nodes, without collision.
+		* Is called from the threads of the pool, like the other functions.
+		* @param fromIndex is the first node.
+		* @param toIndex is the second node.
+		* @return true if the straight line is free. By default return false, so nothing is removed.*/
+		virtual bool HasLineOfSight(unsigned int /*fromIndex*/, unsigned int /*toIndex*/) { return false; }
+
+		/** Optional, used only by the tickets with post process (see Ticket::SetPostProcess()).
+		* Give the position of a node, used to remove the nodes that are on a straight line.
+		* @param nodeIndex is the node.
+		* @param position is the position of the node.
+		* @return false if the position is not known. By default return false.*/
+		virtual bool GetNodePosition(unsigned int /*nodeIndex*/, std::array<float, 3>& /*position*/) { return false; }
 	};
 
 	/** Forward declaration. See bellow the real class.*/
 	class Ticket;
 	class Node;
+	class Landmarks;
+	class ContractionHierarchy;
+	class ParallelSearch;
+	class Batch;
+	class ReservationTable;
 
 
 	/** This is the Main class that implemnts the generic A * (A star) search algorithm.
@@ -92,6 +112,15 @@ namespace fpe
 		/** Add a new request to determine a path */
 		void AddTicket(std::shared_ptr<Ticket> ticket);
 
+		/** Add a group of requests. The requests are split in chunks of chunkSize, and each chunk
+		* is processed by a job of the threads pool. The paths are written in a single buffer. See the Batch class.
+		* If there is no threads pool, the batch is processed right now, on the caller thread.
+		* @param startIndexes are the start nodes.
+		* @param goalIndexes are the target nodes. Must have the same size as startIndexes.
+		* @param chunkSize is how many requests are processed by a job.
+		* @return the batch. Use it to wait the results.*/
+		std::shared_ptr<Batch> AddBatch(const std::vector<unsigned int>& startIndexes, const std::vector<unsigned int>& goalIndexes, unsigned int chunkSize = 64);
+
 		/** This function will run and process every Ticket. If a ticket is supposed to run async,
 		* a job will be posted and a thread from the threads pool will process the ticket. When the 
 		* ticket is solved, will be removed from the list.
@@ -103,6 +132,53 @@ namespace fpe
 		* @return true if pending list with tickets is empty.*/
 		bool Update();
 
+		/** Used to select the heuristic used by the search.*/
+		enum class HeuristicMode : int
+		{
+			/** Only NavMeshBase::ComputeGoalDistanceEstimate is used. This is the default.*/
+			NAVMESH = 0,
+
+			/** Only the landmarks (ALT) heuristic is used.*/
+			LANDMARKS,
+
+			/** The maximum of the two heuristics is used.*/
+			MAX,
+		};
+
+		/** Select the landmarks and precompute the distances tables for the ALT heuristic.
+		* The searches run on the threads pool, but this function is blockant, so call it
+		* from the main thread, before adding the tickets. The result is not used until is
+		* passed to SetLandmarks(). See the Landmarks class.
+		* @param nodesCount is the number of nodes. The nodes indexes must be in [0, nodesCount).
+		* @param landmarksCount is how many landmarks will be selected.
+		* @return the landmarks, or nullptr if the navmesh cannot be read or have no edges.*/
+		std::shared_ptr<Landmarks> ComputeLandmarks(unsigned int nodesCount, unsigned int landmarksCount);
+
+		/** Set the landmarks used by the heuristic.
+		* @param landmarks are the precomputed tables. If is nullptr, only the navmesh heuristic is used.
+		* @param mode tell how the landmarks are combined with the navmesh heuristic.
+		* @param nodesCount is the number of nodes of the navmesh. The tables must have the same number
+		*        of nodes, otherwise they are from another navmesh.
+		* @return false if the tables are for another number of nodes. Then the old landmarks are kept.*/
+		bool SetLandmarks(std::shared_ptr<Landmarks> landmarks, HeuristicMode mode, unsigned int nodesCount);
+
+		/** Build the contraction hierarchy for the navmesh. Use this only if the navmesh does not
+		* change (the neighbors and the costs). The contraction runs on the threads pool, but
+		* this function is blockant, so call it from the main thread. The result is not used until is
+		* passed to SetContractionHierarchy(). See the ContractionHierarchy class.
+		* @param nodesCount is the number of nodes. The nodes indexes must be in [0, nodesCount).
+		* @return the hierarchy, or nullptr if the navmesh cannot be read.*/
+		std::shared_ptr<ContractionHierarchy> ComputeContractionHierarchy(unsigned int nodesCount);
+
+		/** Set the contraction hierarchy. While a hierarchy is set, each ticket is solved in one step
+		* by a hierarchy query, instead of the A* search.
+		* @param hierarchy is the precomputed hierarchy. If is nullptr, the A* search is used again.*/
+		void SetContractionHierarchy(std::shared_ptr<ContractionHierarchy> hierarchy);
+
+		/** Set the reservation table shared by the cooperative tickets. See Ticket::SetCooperative().
+		* @param reservations is the table. If is nullptr, the cooperative tickets are processed as the normal ones.*/
+		void SetReservationTable(std::shared_ptr<ReservationTable> reservations);
+
 	private:
 
 		/** Is a pointer to the used's nav mesh. */
@@ -121,18 +197,82 @@ namespace fpe
 		* @param ticket is the request processed*/
         void ProcessTicketAsync(std::weak_ptr<Ticket> ticket);
 
+		/** This function is used as a job for the threads pool. Will find the paths of a chunk of a batch.
+		* The last chunk processed will size the batch buffer and add a MergeBatchChunk() job for each chunk.
+		* @param batch is the group of requests.
+		* @param chunkIndex is the chunk processed.*/
+		void ProcessBatchChunk(std::shared_ptr<Batch> batch, unsigned int chunkIndex);
+
+		/** This function is used as a job for the threads pool. Will copy the paths of a chunk in the batch buffer,
+		* so the chunks are copied in parallel. The last chunk copied will mark the batch as done.
+		* @param batch is the group of requests.
+		* @param chunkIndex is the chunk copied.
+		* @param base is where the paths of the chunk start in the batch buffer.*/
+		void MergeBatchChunk(std::shared_ptr<Batch> batch, unsigned int chunkIndex, unsigned int base);
+
+		/** Find the path of a cooperative ticket in the (node, time) space, around the reservations
+		* of the other agents, and reserve it. The search is limited by the window, so is done in one call.
+		* @param ticket is the request processed
+		* @param navMesh is the user's navmesh.
+		* @param landmarks are the landmarks tables. Can be null.
+		* @param reservations is the table shared by the agents.*/
+		void ProcessTicketCooperative(std::shared_ptr<Ticket> ticket, NavMeshBase* navMesh, Landmarks* landmarks, ReservationTable* reservations);
+
+		/** Create the parallel search for the ticket and add its jobs to the threads pool.
+		* @param ticket is the request processed
+		* @param jobsCount is how many threads will work on the ticket*/
+		void StartTicketParallel(std::shared_ptr<Ticket> ticket, unsigned int jobsCount);
+
+		/** This function is used as a job for the threads pool, when the ticket runs in parallel.
+		* The last job that finish will set the path and the state of the ticket.
+		* @param ticket is the request processed
+		* @param search is the search shared by all the jobs of the ticket*/
+		void ProcessTicketParallel(std::weak_ptr<Ticket> ticket, std::shared_ptr<ParallelSearch> search);
+
+		/** This is the heuristic used by the search. Depending on m_heuristicMode will return the
+		* value from navmesh, the value from landmarks, or the maximum of them.
+		* @param navMesh is the user's navmesh.
+		* @param landmarks are the landmarks tables. Can be null.
+		* @param goalIndex is the index of the node that represent the target.
+		* @param nodeIndex is the index of the node that you want to calculate the distance.
+		* @return the estimated distance from nodeIndex to goalIndex.*/
+		int ComputeGoalDistanceEstimate(NavMeshBase* navMesh, Landmarks* landmarks, unsigned int goalIndex, unsigned int nodeIndex);
+
+		/** Make the waypoints of a completed ticket, if the ticket have post process (see Ticket::SetPostProcess()).
+		* Is called on the thread that found the path, before the state is set to COMPLETED.
+		* The ticket->m_pathFoundMutex must be locked by the caller.
+		* @param ticket is the request processed
+		* @param navMesh is the user's navmesh.*/
+		void PostProcessTicket(Ticket* ticket, NavMeshBase* navMesh);
+
 		/** Is a list with tickets that must be processed. */
 		std::vector<std::shared_ptr<Ticket> > m_tickets;
 
-        /** Mutex to protect the access to m_tickets*/
+        /** Mutex to protect the access to m_tickets and m_batches*/
         std::recursive_mutex m_ticketsMutex;
 
+		/** The batches added. Are used by Finish() to stop them.*/
+		std::vector<std::weak_ptr<Batch> > m_batches;
+
         /** This is the number of threads that will be used to calculate the paths. 
         * Each thread will calculate a path at a time.*/
 		unsigned int m_threadsCount;
 
 		/** This is the Thread Pool.*/
 		tp::ThreadPool* m_threadsPool;
+
+		/** The tables for the ALT heuristic. Is accessed with std::atomic_load/std::atomic_store,
+		* because can be changed while the tickets are processed on the pool.*/
+		std::shared_ptr<Landmarks> m_landmarks;
+
+		/** How the landmarks are combined with the navmesh heuristic.*/
+		std::atomic<HeuristicMode> m_heuristicMode;
+
+		/** The hierarchy used to answer the tickets. Is accessed with std::atomic_load/std::atomic_store.*/
+		std::shared_ptr<ContractionHierarchy> m_hierarchy;
+
+		/** The table used by the cooperative tickets. Is accessed with std::atomic_load/std::atomic_store.*/
+		std::shared_ptr<ReservationTable> m_reservations;
 	};
 
 
@@ -191,8 +331,11 @@ namespace fpe
 		/** The constructor.
 		* @param startIndex is the start node.
 		* @param goalIndex is the target node 
-		* @param runAsync if is true the path process will run on a separate thread.*/
-		Ticket(unsigned int startIndex, unsigned int goalIndex, bool runAsync);
+		* @param runAsync if is true the path process will run on a separate thread.
+		* @param runParallel if is true (and runAsync is true) the search is split on many threads
+		*        of the pool. Use it only for the long paths, because the threads must talk to each other.
+		*        If no other ticket is waiting, the whole pool is used.*/
+		Ticket(unsigned int startIndex, unsigned int goalIndex, bool runAsync, bool runParallel = false);
 
 		/** Used to describe the possible states of the Ticket.*/
 		enum class State : int
@@ -219,12 +362,25 @@ namespace fpe
 		/** Getter for the detected path. */
 		std::vector<unsigned int>& GetFoundPath();
 
+		/** Getter for the waypoints, from start to goal. Is empty if SetPostProcess() was not called.*/
+		std::vector<unsigned int>& GetWaypoints();
+
+		/** Getter for the waypoints written with PathPostProcess::EncodeWaypoints(). Is empty if
+		* SetPostProcess() was not called with encode = true.*/
+		std::vector<unsigned char>& GetEncodedWaypoints();
+
 		/** Getter for the goal node */
 		unsigned int GetGoalIndex(){ return m_goalIndex; }
 
 		/** Getter for the start node */
 		unsigned int GetStartIndex(){ return m_startIndex; }
 
+		/** Getter for the async flag given to the constructor */
+		bool GetRunAsync(){ return m_runAsync; }
+
+		/** Getter for the parallel flag given to the constructor */
+		bool GetRunParallel(){ return m_runParallel; }
+
 		/** Getter for the open list */
 		std::map<unsigned int, std::shared_ptr<Node> > GetOpenList();
 
@@ -234,6 +390,38 @@ namespace fpe
 		/** Use this function to stop the process of path finding.*/
 		void Stop();
 
+		/** Make this ticket cooperative (WHCA*). Call it before AddTicket(). The search is done in the
+		* (node, time) space, for the next window steps: each step the agent moves to a neighbor or waits,
+		* and the nodes reserved by the other agents in the engine's ReservationTable are avoided.
+		* The path found is reserved, so the next agents plan around it. The path have one node for each
+		* time step (a wait repeats the node) and, if the goal is not reached in the window, ends before the
+		* goal: in this case make a new ticket before the agent reaches the end of the path.
+		* If no path is found, the agent waits on the start node: the path is the start node repeated for
+		* the window. The ticket is stopped only if the start node is reserved by another agent.
+		* @param agentId is the id of the agent. The old reservations of the agent are released when the
+		*        new path is reserved, and are kept if nothing can be reserved.
+		* @param startTime is the time step of the start node.
+		* @param window is how many time steps are planned.
+		* @param waitCost is the cost to stay on the same node for a time step.*/
+		void SetCooperative(unsigned int agentId, unsigned int startTime, unsigned int window, int waitCost);
+
+		/** Getter for the settings given to SetCooperative().
+		* @return false if the ticket is not cooperative. Then the parameters are not changed.*/
+		bool GetCooperative(unsigned int& agentId, unsigned int& startTime, unsigned int& window, int& waitCost);
+
+		/** Make a compact path when the ticket is completed. Call it before AddTicket(). The work is done on
+		* the thread that found the path, and the result is read with GetWaypoints() and GetEncodedWaypoints().
+		* The path of a cooperative ticket is not changed, because it have a node for each time step.
+		* See the PathPostProcess class.
+		* @param stringPulling if is true, the nodes that can be skipped are removed (see NavMeshBase::HasLineOfSight()).
+		* @param removeCollinear if is true, the nodes on a straight line are removed (see NavMeshBase::GetNodePosition()).
+		* @param encode if is true, the waypoints are also encoded, ready to be sent on network.*/
+		void SetPostProcess(bool stringPulling, bool removeCollinear, bool encode);
+
+		/** Getter for the settings given to SetPostProcess().
+		* @return false if the ticket have no post process. Then the parameters are not changed.*/
+		bool GetPostProcess(bool& stringPulling, bool& removeCollinear, bool& encode);
+
 	private:
 
 		/** This is the target */
@@ -254,7 +442,13 @@ namespace fpe
 		/** The list with nodes that represent the detected path */
 		std::vector<unsigned int> m_pathFound;
 
-		/** Protect the m_pathFound for multithread access */
+		/** The compact path, from start to goal. See SetPostProcess().*/
+		std::vector<unsigned int> m_waypoints;
+
+		/** The encoded m_waypoints.*/
+		std::vector<unsigned char> m_encodedWaypoints;
+
+		/** Protect the m_pathFound, m_waypoints and m_encodedWaypoints for multithread access */
 		std::mutex m_pathFoundMutex;
 
 		/** Is the list with possible/available nodes to check.*/
@@ -274,6 +468,21 @@ namespace fpe
 		std::atomic<bool> m_runAsync;
 
 		std::atomic<bool> m_runAsyncQueued;
+
+		std::atomic<bool> m_runParallel;
+
+		/** The settings of a cooperative ticket. See SetCooperative().*/
+		std::atomic<bool> m_cooperative;
+		unsigned int m_agentId;
+		unsigned int m_startTime;
+		unsigned int m_window;
+		int m_waitCost;
+
+		/** The settings of the post process. See SetPostProcess().*/
+		std::atomic<bool> m_postProcess;
+		bool m_stringPulling;
+		bool m_removeCollinear;
+		bool m_encodeWaypoints;
 	};
 
 } // namespace fpe
@@ -0,0 +1,89 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include <vector>
+#include <string>
+
+
+/// forward declaration for ThreadPool
+namespace tp
+{
+	class ThreadPool;
+}
+
+namespace fpe
+{
+	/** Forward declaration. */
+	class StaticGraph;
+
+	/** This class implements the ALT heuristic (A*, Landmarks, Triangle inequality).
+	* A few nodes are selected as landmarks and the exact distances from every node to every
+	* landmark (and back) are precomputed. Using the triangle inequality these tables give a
+	* lower bound of the distance between any two nodes, so the heuristic is admissible on
+	* any graph, not only on grids.
+	* How to use it:
+	* // ------------------
+	* std::shared_ptr<fpe::Landmarks> landmarks = std::make_shared<fpe::Landmarks>();
+	* if (!landmarks->Load("landmarks.bin"))
+	* {
+	*   landmarks = engine->ComputeLandmarks(NavMesh::k_meshSize, 8);
+	*   landmarks->Save("landmarks.bin");
+	* }
+	* engine->SetLandmarks(landmarks, fpe::FindPathEngine::HeuristicMode::MAX, NavMesh::k_meshSize);
+	* // ------------------*/
+	class Landmarks
+	{
+	public:
+
+		/** The constructor. The tables are empty until Compute() or Load() is called.*/
+		Landmarks();
+
+		/** Select the landmarks and compute the distances tables.
+		* The landmarks are selected with the "farthest" method: each new landmark is the node
+		* that is the farthest from the landmarks already selected. The searches that are not needed
+		* for the selection run in parallel on the threads pool. This function is blockant.
+		* @param graph is the snapshot of the navmesh.
+		* @param landmarksCount is how many landmarks will be selected.
+		* @param threadsPool is the pool used for the searches. Can be null, then all runs on the caller thread.
+		* @return false if no landmark can be selected (the graph has no edges).*/
+		bool Compute(const StaticGraph& graph, unsigned int landmarksCount, tp::ThreadPool* threadsPool);
+
+		/** Save the tables to a binary file (native byte order).
+		* @return false if the file cannot be written.*/
+		bool Save(const std::string& fileName) const;
+
+		/** Load the tables from a binary file written by Save().
+		* @return false if the file cannot be read or is not valid. In this case the tables are left empty.*/
+		bool Load(const std::string& fileName);
+
+		/** This is the ALT heuristic. Is a lower bound of the distance from nodeIndex to goalIndex.
+		* @param goalIndex is the index of the node that represent the target.
+		* @param nodeIndex is the index of the node that you want to calculate the distance.
+		* @return the estimated distance from nodeIndex to goalIndex, or 0 if no landmark can tell.*/
+		int ComputeGoalDistanceEstimate(unsigned int goalIndex, unsigned int nodeIndex) const;
+
+		/** Getter for the number of nodes covered by the tables */
+		unsigned int GetNodesCount() const { return m_nodesCount; }
+
+		/** Getter for the selected landmarks */
+		const std::vector<unsigned int>& GetLandmarks() const { return m_landmarks; }
+
+	private:
+
+		/** How many nodes are in the tables */
+		unsigned int m_nodesCount;
+
+		/** The list with the nodes selected as landmarks */
+		std::vector<unsigned int> m_landmarks;
+
+		/** The distance from the landmark k to node n is m_fromLandmark[n * landmarksCount + k].
+		* The values for a node are stored together because the heuristic reads all of them.*/
+		std::vector<int> m_fromLandmark;
+
+		/** The distance from node n to the landmark k is m_toLandmark[n * landmarksCount + k].*/
+		std::vector<int> m_toLandmark;
+	};
+
+} // namespace fpe
+
+#endif //LANDMARKS_H
@@ -0,0 +1,53 @@
+#ifndef PATHPOSTPROCESS_H
+#define PATHPOSTPROCESS_H
+
+#include <vector>
+
+
+namespace fpe
+{
+	class NavMeshBase;
+
+	/** These are the functions used to make a compact path from the path found by the search.
+	* The search gives every node visited, so a long path on a grid have thousands of nodes. The
+	* waypoints keep only the nodes where the agent must change direction.
+	* The engine call them on the threads of the pool when a ticket with post process is completed
+	* (see Ticket::SetPostProcess()), but they can be used also on any path.
+	* How to decode the waypoints received from network:
+	* // ------------------
+	* std::vector<unsigned int> waypoints;
+	* if (fpe::PathPostProcess::DecodeWaypoints(data, waypoints))
+	* {
+	*   /// waypoints are from start to goal
+	* }
+	* // ------------------*/
+	class PathPostProcess
+	{
+	public:
+
+		/** Make the waypoints from a path.
+		* @param navMesh is the user's navmesh. Its HasLineOfSight() and GetNodePosition() are used.
+		* @param path is the path in the order used by Ticket::GetFoundPath(): goal -> start.
+		* @param stringPulling if is true, the nodes that can be skipped in a straight line
+		*        (see NavMeshBase::HasLineOfSight()) are removed.
+		* @param removeCollinear if is true, the nodes that are on the line between the previous
+		*        and the next node (see NavMeshBase::GetNodePosition()) are removed.
+		* @param waypoints is the result, from start to goal. The start and the goal are always kept.*/
+		static void BuildWaypoints(NavMeshBase* navMesh, const std::vector<unsigned int>& path, bool stringPulling, bool removeCollinear, std::vector<unsigned int>& waypoints);
+
+		/** Write the waypoints in a compact form, for network: the count, the first node, and each
+		* next node as difference from the previous one, with varint coding.
+		* @param waypoints are the nodes.
+		* @param data is the result. The old content is replaced.*/
+		static void EncodeWaypoints(const std::vector<unsigned int>& waypoints, std::vector<unsigned char>& data);
+
+		/** Read the waypoints written by EncodeWaypoints().
+		* @param data is the encoded waypoints.
+		* @param waypoints is the result. The old content is replaced.
+		* @return false if the data is not valid.*/
+		static bool DecodeWaypoints(const std::vector<unsigned char>& data, std::vector<unsigned int>& waypoints);
+	};
+
+} // namespace fpe
+
+#endif //PATHPOSTPROCESS_H
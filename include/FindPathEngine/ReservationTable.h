@@ -0,0 +1,96 @@
+#ifndef RESERVATIONTABLE_H
+#define RESERVATIONTABLE_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace fpe
+{
+	/** This is the space-time reservation table used by the cooperative tickets (WHCA*).
+	* Each agent reserves the (node, time) pairs of its path, so the other agents plan around them.
+	* The table is split in shards, each with its own mutex, so the threads of the pool that
+	* process different tickets rarely wait one for another.
+	* How to use it:
+	* // ------------------
+	* std::shared_ptr<fpe::ReservationTable> reservations = std::make_shared<fpe::ReservationTable>();
+	* engine->SetReservationTable(reservations);
+	*
+	* ticket->SetCooperative(agentId, currentTime, 16, 10); // plan 16 steps ahead, a wait costs 10
+	* engine->AddTicket(ticket);
+	*
+	* reservations->ReleaseBefore(currentTime); // each step, forget the past
+	* // ------------------*/
+	class ReservationTable
+	{
+	public:
+
+		/** This is returned by GetOwner() when nobody reserved the node.*/
+		static const unsigned int k_noAgent = 0xFFFFFFFF;
+
+		/** The constructor.
+		* @param shardsCount is the number of shards. Use more shards when more threads use the table.*/
+		ReservationTable(unsigned int shardsCount = 64);
+
+		/** Get the agent that reserved the node at the time.
+		* @return the agent id, or k_noAgent.*/
+		unsigned int GetOwner(unsigned int nodeIndex, unsigned int time);
+
+		/** Check if the agent can use the node at the time.
+		* @return true if nobody reserved the node, or if the agent reserved it.*/
+		bool IsFree(unsigned int agentId, unsigned int nodeIndex, unsigned int time);
+
+		/** Reserve the node at the time.
+		* @return false if the node is already reserved by another agent.*/
+		bool Reserve(unsigned int agentId, unsigned int nodeIndex, unsigned int time);
+
+		/** Reserve all the nodes of a path: path[i] is reserved at startTime + i. If a node is
+		* reserved by another agent, or if the path swaps two nodes with another agent, the nodes
+		* reserved by this call are released.
+		* @return false if the path is in conflict with another agent. Then nothing is reserved.*/
+		bool ReservePath(unsigned int agentId, const std::vector<unsigned int>& path, unsigned int startTime);
+
+		/** Reserve the path like ReservePath(), then release the other reservations of the agent.
+		* The old path is kept until the new one is reserved, so the agent is never without reservations.
+		* @return false if the path is in conflict with another agent. Then the old reservations are kept.*/
+		bool ReplacePath(unsigned int agentId, const std::vector<unsigned int>& path, unsigned int startTime);
+
+		/** Remove all the reservations of the agent.*/
+		void Release(unsigned int agentId);
+
+		/** Remove the reservations older than the time. Call this regularly, when the time advances.*/
+		void ReleaseBefore(unsigned int time);
+
+	private:
+
+		/** The key of a (node, time) pair */
+		static uint64_t GetKey(unsigned int nodeIndex, unsigned int time)
+		{
+			return ((uint64_t)time << 32) | nodeIndex;
+		}
+
+		struct Shard
+		{
+			std::mutex m_mutex;
+
+			/** (node, time) -> agent */
+			std::unordered_map<uint64_t, unsigned int> m_owners;
+
+			/** agent -> the keys reserved by the agent, for the agents of this shard */
+			std::unordered_map<unsigned int, std::vector<uint64_t> > m_agents;
+		};
+
+		Shard& GetShard(uint64_t key);
+
+		/** Remove the key, if is owned by the agent.*/
+		void Unreserve(unsigned int agentId, uint64_t key);
+
+		std::vector<std::unique_ptr<Shard> > m_shards;
+	};
+
+} // namespace fpe
+
+#endif //RESERVATIONTABLE_H
@@ -0,0 +1,62 @@
+#ifndef STATICGRAPH_H
+#define STATICGRAPH_H
+
+#include <vector>
+#include <memory>
+#include <climits>
+
+
+namespace fpe
+{
+	/** Forward declaration. */
+	class NavMeshBase;
+
+	/** This is a snapshot of the user's navmesh, stored as adjacency arrays (CSR).
+	* The snapshot is taken once, by calling GetNeighbors and ComputeCost for every node,
+	* so the precomputation passes (landmarks, contraction hierarchies) can walk the graph
+	* without virtual calls and can also walk it backward.*/
+	class StaticGraph
+	{
+	public:
+
+		/** This value is used for the nodes that cannot be reached.*/
+		static const int k_unreachable = INT_MAX;
+
+		/** The constructor. The graph is empty until Build() is called.*/
+		StaticGraph();
+
+		/** Take the snapshot of the navmesh.
+		* @param navMesh is the user's navmesh.
+		* @param nodesCount is the number of nodes. The nodes indexes must be in [0, nodesCount).
+		* @return false if the navMesh is destroied or if a neighbor index is outside the range.*/
+		bool Build(std::weak_ptr<NavMeshBase> navMesh, unsigned int nodesCount);
+
+		/** Getter for the number of nodes */
+		unsigned int GetNodesCount() const { return m_nodesCount; }
+
+		/** Run a Dijkstra search starting from source node.
+		* @param source is the start node.
+		* @param backward if is true the edges are walked in reverse, so distances[i] will be the
+		*        distance from node i to source, otherwise the distance from source to node i.
+		* @param distances is filled with nodesCount values. k_unreachable is used for nodes that cannot be reached.*/
+		void ComputeDistances(unsigned int source, bool backward, std::vector<int>& distances) const;
+
+		/** The first outgoing edge of node is m_forwardOffsets[node] and the last one is m_forwardOffsets[node + 1] - 1.*/
+		std::vector<unsigned int> m_forwardOffsets;
+		std::vector<unsigned int> m_forwardTargets;
+		std::vector<int> m_forwardCosts;
+
+		/** The same as above, but for the incoming edges.*/
+		std::vector<unsigned int> m_backwardOffsets;
+		std::vector<unsigned int> m_backwardTargets;
+		std::vector<int> m_backwardCosts;
+
+	private:
+
+		/** How many nodes are in the graph */
+		unsigned int m_nodesCount;
+	};
+
+} // namespace fpe
+
+#endif //STATICGRAPH_H
@@ -0,0 +1,96 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace fpe
+{
+	/** This is a recorded workload: the tickets, as they were added, and the answers of the
+	* navmesh (the neighbors, the costs, the heuristic values, and for the post process the lines
+	* of sight and the positions) seen while they were processed.
+	* Is written by TraceRecorder and replayed by TraceReplay.
+	* The file is compact: the numbers are delta encoded and written with a variable length.*/
+	class Trace
+	{
+	public:
+
+		/** This is a ticket, as it was added. */
+		struct TicketRecord
+		{
+			/** Microseconds since the recording was started */
+			uint64_t m_time;
+
+			unsigned int m_startIndex;
+
+			unsigned int m_goalIndex;
+
+			bool m_runAsync;
+
+			bool m_runParallel;
+
+			/** The settings of Ticket::SetCooperative(), used if m_cooperative is true */
+			bool m_cooperative;
+			unsigned int m_agentId;
+			unsigned int m_startTime;
+			unsigned int m_window;
+			int m_waitCost;
+
+			/** The settings of Ticket::SetPostProcess(), used if m_postProcess is true */
+			bool m_postProcess;
+			bool m_stringPulling;
+			bool m_removeCollinear;
+			bool m_encodeWaypoints;
+		};
+
+		/** This is the answer of NavMeshBase::GetNodePosition() */
+		struct PositionRecord
+		{
+			bool m_known;
+
+			std::array<float, 3> m_position;
+		};
+
+		/** The key of a pair of nodes, used by m_costs and m_estimates */
+		static uint64_t GetKey(unsigned int first, unsigned int second)
+		{
+			return ((uint64_t)first << 32) | second;
+		}
+
+		/** Write the trace to a binary file.
+		* @return false if the file cannot be written.*/
+		bool Save(const std::string& fileName) const;
+
+		/** Read the trace from a binary file written by Save().
+		* @return false if the file cannot be read or is not valid. In this case the trace is left empty.*/
+		bool Load(const std::string& fileName);
+
+		/** Remove everything.*/
+		void Clear();
+
+		/** node -> neighbors */
+		std::unordered_map<unsigned int, std::vector<unsigned int> > m_neighbors;
+
+		/** (node, neighbor) -> cost */
+		std::unordered_map<uint64_t, int> m_costs;
+
+		/** (goal, node) -> estimated distance */
+		std::unordered_map<uint64_t, int> m_estimates;
+
+		/** (from, to) -> 1 if there is a line of sight, otherwise 0 */
+		std::unordered_map<uint64_t, int> m_linesOfSight;
+
+		/** node -> position */
+		std::unordered_map<unsigned int, PositionRecord> m_positions;
+
+		/** The tickets, in the order they were added */
+		std::vector<TicketRecord> m_tickets;
+	};
+
+} // namespace fpe
+
+#endif //TRACE_H
@@ -0,0 +1,92 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include "FindPathEngine/FindPathEngine.h"
+#include "FindPathEngine/Trace.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+
+namespace fpe
+{
+	/** This class records a workload, so it can be replayed offline with TraceReplay.
+	* It is a navmesh that forwards the calls to the user's navmesh and remembers the answers,
+	* and it remembers when each ticket was added, what was asked, and the cooperative and
+	* post process settings of the ticket. The trace file does not need the user's navmesh
+	* to be replayed.
+	* Each thread writes the answers in its own buffer, so the threads of the pool do not wait
+	* one for another. The buffers are merged by Save().
+	* How to use it:
+	* // ------------------
+	* std::shared_ptr<fpe::TraceRecorder> recorder = std::make_shared<fpe::TraceRecorder>(navmesh);
+	* std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(recorder, 6);
+	*
+	* recorder->AddTicket(engine, ticket); // instead of engine->AddTicket(ticket)
+	* ...
+	* recorder->Save("workload.trace");
+	* // ------------------*/
+	class TraceRecorder : public NavMeshBase
+	{
+	public:
+
+		/** The constructor. The time of the tickets is measured from now.
+		* @param navMesh is the user's navmesh.*/
+		TraceRecorder(std::weak_ptr<NavMeshBase> navMesh);
+
+		int ComputeGoalDistanceEstimate(unsigned int goalIndex, unsigned int nodeIndex) override;
+
+		int ComputeCost(unsigned int nodeIndex, unsigned int neighborIndex) override;
+
+		std::vector<unsigned int> GetNeighbors(unsigned int nodeIndex) override;
+
+		bool HasLineOfSight(unsigned int fromIndex, unsigned int toIndex) override;
+
+		bool GetNodePosition(unsigned int nodeIndex, std::array<float, 3>& position) override;
+
+		/** Record the ticket and add it to the engine.*/
+		void AddTicket(std::shared_ptr<FindPathEngine> engine, std::shared_ptr<Ticket> ticket);
+
+		/** Merge the buffers of the threads and write the trace recorded until now to a binary file.
+		* @return false if the file cannot be written.*/
+		bool Save(const std::string& fileName);
+
+	private:
+
+		/** The part of the workload recorded by a thread. Only its thread writes it, so the
+		* mutex is taken without waiting, except when Save() reads the buffer.*/
+		struct ThreadBuffer
+		{
+			std::mutex m_mutex;
+
+			Trace m_trace;
+
+			/** The order in which each ticket of m_trace was added, between all the threads */
+			std::vector<uint64_t> m_ticketsOrder;
+		};
+
+		/** Get the buffer of the calling thread. Is created at the first call from the thread.*/
+		std::shared_ptr<ThreadBuffer> GetThreadBuffer();
+
+		std::weak_ptr<NavMeshBase> m_navMesh;
+
+		std::chrono::steady_clock::time_point m_startTime;
+
+		/** Is unique for each recorder. The threads use it to find their buffer of this recorder.*/
+		uint64_t m_id;
+
+		/** The buffers of all the threads that called the recorder.*/
+		std::vector<std::shared_ptr<ThreadBuffer> > m_buffers;
+
+		/** Protect m_buffers. Is taken only when a thread makes its buffer, and by Save().*/
+		std::mutex m_buffersMutex;
+
+		/** How many tickets were added, used to keep their order */
+		std::atomic<uint64_t> m_ticketsCount;
+	};
+
+} // namespace fpe
+
+#endif //TRACERECORDER_H
@@ -0,0 +1,103 @@
+#ifndef TRACEREPLAY_H
+#define TRACEREPLAY_H
+
+#include "FindPathEngine/FindPathEngine.h"
+#include "FindPathEngine/Trace.h"
+
+#include <ostream>
+#include <functional>
+
+
+namespace fpe
+{
+	/** This class replays a workload recorded by TraceRecorder. The navmesh answers are taken
+	* from the trace, so the replay gives the same work at any threads count, on any machine.
+	* The tickets get the cooperative and post process settings they were recorded with. The
+	* cooperative tickets share a new ReservationTable, so only the reservations of the replayed
+	* tickets are known. A cooperative ticket is added only after the cooperative tickets before it
+	* are done, and the reservations older than its start time are released then. So the agents
+	* reserve in the recorded order, and the replay is the same at any threads count. The other
+	* tickets are not waiting for them. If the searches differ from the recording, the report shows misses.
+	* The parallel tickets (see Ticket) expand the nodes in any order, so their steps change from
+	* one replay to another.
+	* How to use it:
+	* // ------------------
+	* fpe::TraceReplay replay;
+	* replay.Load("workload.trace");
+	*
+	* for (unsigned int threads = 1; threads <= 8; threads *= 2)
+	* {
+	*   replay.Run(threads, true, [landmarks](std::shared_ptr<fpe::FindPathEngine> engine)
+	*   {
+	*     // the same settings as when the trace was recorded
+	*     engine->SetLandmarks(landmarks, fpe::FindPathEngine::HeuristicMode::MAX, nodesCount);
+	*   }).Print(std::cout);
+	* }
+	* // ------------------*/
+	class TraceReplay
+	{
+	public:
+
+		/** The timings of a replay. All the times are in milliseconds.*/
+		struct Report
+		{
+			unsigned int m_threadsCount;
+
+			unsigned int m_ticketsCount;
+
+			unsigned int m_completedCount;
+
+			unsigned int m_stoppedCount;
+
+			/** The sum of the steps of all the tickets */
+			long long m_steps;
+
+			/** The navmesh questions that were not in the trace. They are answered with no neighbors
+			* and cost 0, so if this is not 0 the replay did not do the recorded work and the timings
+			* cannot be compared (e.g. the trace is from an older engine that searched differently).*/
+			unsigned int m_missesCount;
+
+			/** From the first ticket added until the last one was done */
+			double m_totalTime;
+
+			/** The time from AddTicket until the ticket was seen done by Update */
+			double m_minLatency;
+			double m_averageLatency;
+			double m_medianLatency;
+			double m_p95Latency;
+			double m_maxLatency;
+
+			/** Write the report, in a human readable form.*/
+			void Print(std::ostream& stream) const;
+		};
+
+		/** The constructor. The trace is empty until Load() is called.*/
+		TraceReplay();
+
+		/** Read the trace from a file written by TraceRecorder.
+		* @return false if the file cannot be read or is not valid.*/
+		bool Load(const std::string& fileName);
+
+		/** Run the workload on a new engine. This function is blockant.
+		* @param threadsCount is the number of threads of the engine.
+		* @param keepArrivalTimes if is true each ticket is added at the recorded time,
+		*        otherwise all the tickets are added at once.
+		* @param setup is called with the new engine, before the first ticket is added. Use it to give the
+		*        engine the landmarks, the contraction hierarchy or the heuristic mode used when the trace was
+		*        recorded. The engine's navmesh answers only from the trace, so compute them on the real navmesh.
+		*        The navmesh questions asked by setup are not counted as misses. Can be nullptr.
+		* @return the timings.*/
+		Report Run(unsigned int threadsCount, bool keepArrivalTimes, std::function<void(std::shared_ptr<FindPathEngine>)> setup = nullptr);
+
+		/** Getter for the trace */
+		const Trace& GetTrace() const { return *m_trace; }
+
+	private:
+
+		/** The trace is shared with the navmesh used by the engine */
+		std::shared_ptr<Trace> m_trace;
+	};
+
+} // namespace fpe
+
+#endif //TRACEREPLAY_H
@@ -0,0 +1,43 @@
+
+#include "FindPathEngine/Batch.h"
+
+
+namespace fpe
+{
+	Batch::Batch(const std::vector<unsigned int>& startIndexes, const std::vector<unsigned int>& goalIndexes, unsigned int chunkSize)
+		: m_startIndexes(startIndexes)
+		, m_goalIndexes(goalIndexes)
+		, m_chunkSize(chunkSize > 0 ? chunkSize : 1)
+		, m_pendingChunks(0)
+		, m_pendingMerges(0)
+		, m_mustStop(false)
+		, m_done(false)
+	{
+		/// Only the pairs are used. The extra start or goal nodes are ignored.
+		if (m_goalIndexes.size() < m_startIndexes.size())
+			m_startIndexes.resize(m_goalIndexes.size());
+		m_goalIndexes.resize(m_startIndexes.size());
+
+		unsigned int count = (unsigned int)m_startIndexes.size();
+		unsigned int chunksCount = (count + m_chunkSize - 1) / m_chunkSize;
+
+		m_chunkNodes.resize(chunksCount);
+		m_offsets.assign(count, 0);
+		m_lengths.assign(count, 0);
+		m_statuses.assign(count, Status::WAITING);
+		m_pendingChunks = chunksCount;
+		m_pendingMerges = chunksCount;
+		m_done = (chunksCount == 0);
+	}
+
+	void Batch::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_doneMutex);
+		m_doneCondition.wait(lock, [this]() { return (bool)m_done; });
+	}
+
+	void Batch::Stop()
+	{
+		m_mustStop = true;
+	}
+} //namespace fpe
@@ -0,0 +1,797 @@
+
+#include "FindPathEngine/ContractionHierarchy.h"
+#include "FindPathEngine/StaticGraph.h"
+
+#include "JobsGroup.h"
+
+#include <algorithm>
+#include <functional>
+
+
+namespace fpe
+{
+	const unsigned int ContractionHierarchy::k_noMiddle;
+
+	/** The witness search stops after this many nodes are settled, or when the paths have this many
+	* edges. A witness that is not found only adds a shortcut that is not needed, so the hierarchy is
+	* still correct. The priorities are only estimations, so they use a smaller search.*/
+	static const unsigned int k_witnessSettledLimit = 500;
+	static const unsigned int k_witnessHopsLimit = 5;
+	static const unsigned int k_priorityHopsLimit = 1;
+
+	/** The parallel loops give at least this many nodes to a job.*/
+	static const unsigned int k_minNodesPerJob = 256;
+
+	/** This is an edge of the graph while the nodes are contracted. */
+	struct BuildEdge
+	{
+		BuildEdge(unsigned int node, int cost, unsigned int middle, unsigned int hops)
+			: m_node(node)
+			, m_cost(cost)
+			, m_middle(middle)
+			, m_hops(hops)
+		{
+		}
+
+		/** The other end of the edge */
+		unsigned int m_node;
+
+		int m_cost;
+
+		/** The contracted node replaced by this shortcut */
+		unsigned int m_middle;
+
+		/** How many original edges are replaced by this edge */
+		unsigned int m_hops;
+	};
+
+	typedef std::vector<std::vector<BuildEdge> > BuildEdges;
+
+	/** This is the Dijkstra used to check if a path that avoids the contracted node exists.
+	* The distances array is reused, only the touched values are reset. Each thread have its own.*/
+	class WitnessSearch
+	{
+	public:
+		WitnessSearch()
+		{
+		}
+
+		/** Search from source, without passing through excluded or the nodes flagged in excludedFlags.
+		* The search stops when all the targets are settled, at maxCost, or when the paths have hopsLimit edges.*/
+		void Run(const BuildEdges& out, unsigned int source, unsigned int excluded, const std::vector<unsigned char>& excludedFlags,
+			const std::vector<BuildEdge>& targets, int maxCost, unsigned int hopsLimit)
+		{
+			if (m_distances.size() != out.size())
+			{
+				m_distances.assign(out.size(), StaticGraph::k_unreachable);
+				m_hops.resize(out.size());
+				m_isTarget.assign(out.size(), 0);
+				m_touched.clear();
+			}
+
+			unsigned int targetsLeft = 0;
+			for (auto& target : targets)
+			{
+				if ((target.m_node != source) && !m_isTarget[target.m_node])
+				{
+					m_isTarget[target.m_node] = 1;
+					targetsLeft++;
+				}
+			}
+
+			for (auto& node : m_touched)
+			{
+				m_distances[node] = StaticGraph::k_unreachable;
+			}
+			m_touched.clear();
+
+			typedef std::pair<int, unsigned int> Entry;
+			const std::greater<Entry> compare;
+			m_open.clear();
+
+			m_distances[source] = 0;
+			m_hops[source] = 0;
+			m_touched.push_back(source);
+			m_open.push_back(Entry(0, source));
+
+			unsigned int settled = 0;
+			while (!m_open.empty() && (settled < k_witnessSettledLimit))
+			{
+				std::pop_heap(m_open.begin(), m_open.end(), compare);
+				Entry entry = m_open.back();
+				m_open.pop_back();
+
+				if (entry.first > m_distances[entry.second])
+					continue;
+
+				if (entry.first > maxCost)
+					break;
+
+				settled++;
+
+				if (m_isTarget[entry.second] && (--targetsLeft == 0))
+					break;
+
+				if (m_hops[entry.second] >= hopsLimit)
+					continue;
+
+				for (auto& edge : out[entry.second])
+				{
+					if ((edge.m_node == excluded) || excludedFlags[edge.m_node])
+						continue;
+
+					int dist = entry.first + edge.m_cost;
+					if (dist < m_distances[edge.m_node])
+					{
+						if (m_distances[edge.m_node] == StaticGraph::k_unreachable)
+							m_touched.push_back(edge.m_node);
+
+						m_distances[edge.m_node] = dist;
+						m_hops[edge.m_node] = m_hops[entry.second] + 1;
+						m_open.push_back(Entry(dist, edge.m_node));
+						std::push_heap(m_open.begin(), m_open.end(), compare);
+					}
+				}
+			}
+
+			for (auto& target : targets)
+			{
+				m_isTarget[target.m_node] = 0;
+			}
+		}
+
+		int GetDistance(unsigned int node) const { return m_distances[node]; }
+
+	private:
+		std::vector<int> m_distances;
+
+		/** How many edges are on the path to the node */
+		std::vector<unsigned int> m_hops;
+
+		/** The nodes that the search must reach */
+		std::vector<unsigned char> m_isTarget;
+
+		/** The open list, as a heap (see std::push_heap), so its memory is reused.*/
+		std::vector<std::pair<int, unsigned int> > m_open;
+
+		std::vector<unsigned int> m_touched;
+	};
+
+	/** Each thread of the pool have its own witness search, reused by all the jobs it runs.*/
+	static WitnessSearch& GetWitnessSearch()
+	{
+		static thread_local WitnessSearch witness;
+		return witness;
+	}
+
+	/** This is a shortcut that must be added when a node is contracted. */
+	struct Shortcut
+	{
+		unsigned int m_from;
+		unsigned int m_to;
+		int m_cost;
+		unsigned int m_hops;
+	};
+
+	/** Find the shortcuts needed to contract the node.
+	* @param excludedFlags are the nodes contracted at the same time, that the witnesses must avoid.
+	* @param shortcuts if is not null, the shortcuts are added to this list.
+	* @param hops is set to how many original edges are replaced by the shortcuts.
+	* @return how many shortcuts are needed.*/
+	static unsigned int FindShortcuts(const BuildEdges& out, const BuildEdges& in, unsigned int node,
+		const std::vector<unsigned char>& excludedFlags, unsigned int hopsLimit, WitnessSearch& witness,
+		std::vector<Shortcut>* shortcuts, unsigned int& hops)
+	{
+		unsigned int count = 0;
+		hops = 0;
+
+		int maxOut = 0;
+		for (auto& edgeOut : out[node])
+		{
+			maxOut = std::max(maxOut, edgeOut.m_cost);
+		}
+
+		for (auto& edgeIn : in[node])
+		{
+			witness.Run(out, edgeIn.m_node, node, excludedFlags, out[node], edgeIn.m_cost + maxOut, hopsLimit);
+
+			for (auto& edgeOut : out[node])
+			{
+				if (edgeOut.m_node == edgeIn.m_node)
+					continue;
+
+				/// If the path that avoids the node is longer, the shortcut is needed.
+				int cost = edgeIn.m_cost + edgeOut.m_cost;
+				if (witness.GetDistance(edgeOut.m_node) > cost)
+				{
+					count++;
+					hops += edgeIn.m_hops + edgeOut.m_hops;
+					if (shortcuts != nullptr)
+					{
+						Shortcut shortcut = { edgeIn.m_node, edgeOut.m_node, cost, edgeIn.m_hops + edgeOut.m_hops };
+						shortcuts->push_back(shortcut);
+					}
+				}
+			}
+		}
+
+		return count;
+	}
+
+	/** The nodes with a small priority are contracted first.
+	* This is the level (how deep are the shortcuts under the node), that keeps the hierarchy flat,
+	* plus how many edges are added for each edge removed, plus how many original edges the added
+	* shortcuts replace for each original edge removed. These two keep the graph sparse.
+	* The last term is the part of the edges of the node that were removed by contracting its
+	* neighbors (the deleted neighbors), so the contraction is spread evenly on the graph.*/
+	static float ComputePriority(const BuildEdges& out, const BuildEdges& in, const std::vector<int>& levels,
+		const std::vector<unsigned int>& deleted, unsigned int node, const std::vector<unsigned char>& excludedFlags, WitnessSearch& witness)
+	{
+		unsigned int addedHops = 0;
+		unsigned int added = FindShortcuts(out, in, node, excludedFlags, k_priorityHopsLimit, witness, nullptr, addedHops);
+
+		unsigned int removed = 0;
+		unsigned int removedHops = 0;
+		for (int dir = 0; dir < 2; dir++)
+		{
+			for (auto& edge : (dir == 0) ? out[node] : in[node])
+			{
+				removed++;
+				removedHops += edge.m_hops;
+			}
+		}
+
+		if (removed == 0)
+			return (float)levels[node];
+
+		return (float)levels[node] + (float)added / removed + (float)addedHops / removedHops
+			+ (float)deleted[node] / (deleted[node] + removed);
+	}
+
+	/** Add the edge, or lower the cost of the existing edge.*/
+	static void AddEdge(BuildEdges& out, BuildEdges& in, unsigned int from, unsigned int to, int cost, unsigned int middle, unsigned int hops)
+	{
+		for (auto& edge : out[from])
+		{
+			if (edge.m_node != to)
+				continue;
+
+			if (edge.m_cost > cost)
+			{
+				edge.m_cost = cost;
+				edge.m_middle = middle;
+				edge.m_hops = hops;
+
+				for (auto& reverse : in[to])
+				{
+					if (reverse.m_node == from)
+					{
+						reverse.m_cost = cost;
+						reverse.m_middle = middle;
+						reverse.m_hops = hops;
+					}
+				}
+			}
+			return;
+		}
+
+		out[from].push_back(BuildEdge(to, cost, middle, hops));
+		in[to].push_back(BuildEdge(from, cost, middle, hops));
+	}
+
+	/** Remove the edges to the node from the list.*/
+	static void RemoveEdges(std::vector<BuildEdge>& edges, unsigned int node)
+	{
+		edges.erase(std::remove_if(edges.begin(), edges.end(),
+			[node](const BuildEdge& edge) { return edge.m_node == node; }), edges.end());
+	}
+
+	/** Used to break the ties between the priorities. The node index is not used directly, because
+	* on a grid a node would have almost always a smaller index than its neighbors, so only a few
+	* nodes would be selected in each round.*/
+	static unsigned int TieBreak(unsigned int node)
+	{
+		node ^= node >> 16;
+		node *= 0x85EBCA6B;
+		node ^= node >> 13;
+		node *= 0xC2B2AE35;
+		node ^= node >> 16;
+		return node;
+	}
+
+	/** Split the items in chunks and run function(first, last) for each chunk on the threads pool.
+	* This function is blockant.*/
+	static void ParallelFor(tp::ThreadPool* threadsPool, unsigned int count, const std::function<void(unsigned int, unsigned int)>& function)
+	{
+		const unsigned int jobsCount = 64;
+		const unsigned int chunk = std::max((count + jobsCount - 1) / jobsCount, k_minNodesPerJob);
+
+		JobsGroup jobs(threadsPool);
+		for (unsigned int first = 0; first < count; first += chunk)
+		{
+			unsigned int last = std::min(first + chunk, count);
+			jobs.AddJob([&function, first, last]()
+			{
+				function(first, last);
+			});
+		}
+		jobs.Wait();
+	}
+
+
+	ContractionHierarchy::ContractionHierarchy()
+		: m_nodesCount(0)
+		, m_shortcutsCount(0)
+	{
+	}
+
+	void ContractionHierarchy::Build(const StaticGraph& graph, tp::ThreadPool* threadsPool)
+	{
+		const unsigned int nodesCount = graph.GetNodesCount();
+
+		m_nodesCount = nodesCount;
+		m_shortcutsCount = 0;
+		std::vector<unsigned int> ranks(nodesCount, 0);
+
+		/// Copy the graph. The self loops and the duplicated edges are removed.
+		BuildEdges out(nodesCount);
+		BuildEdges in(nodesCount);
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			for (unsigned int e = graph.m_forwardOffsets[node]; e < graph.m_forwardOffsets[node + 1]; e++)
+			{
+				if (graph.m_forwardTargets[e] != node)
+					AddEdge(out, in, node, graph.m_forwardTargets[e], graph.m_forwardCosts[e], k_noMiddle, 1);
+			}
+		}
+
+		std::vector<int> levels(nodesCount, 0);
+
+		/// How many edges of each node were removed by the contraction of its neighbors.
+		std::vector<unsigned int> deleted(nodesCount, 0);
+
+		/// The nodes contracted in the current round. The witnesses must avoid them.
+		std::vector<unsigned char> inRound(nodesCount, 0);
+
+		/// The nodes not contracted yet.
+		std::vector<unsigned int> remaining(nodesCount);
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			remaining[node] = node;
+		}
+
+		/// The priorities do not depend one on each other, so compute them in parallel.
+		std::vector<float> priorities(nodesCount, 0);
+		ParallelFor(threadsPool, nodesCount, [&](unsigned int first, unsigned int last)
+		{
+			WitnessSearch& witness = GetWitnessSearch();
+			for (unsigned int node = first; node < last; node++)
+			{
+				priorities[node] = ComputePriority(out, in, levels, deleted, node, inRound, witness);
+			}
+		});
+
+		/// The up edges of each node are saved when the node is contracted.
+		BuildEdges up(nodesCount);
+		BuildEdges down(nodesCount);
+
+		std::vector<std::vector<Shortcut> > shortcuts(nodesCount);
+		std::vector<unsigned int> round;
+		std::vector<unsigned int> updated;
+		std::vector<unsigned char> isUpdated(nodesCount, 0);
+		unsigned int rank = 0;
+
+		while (!remaining.empty())
+		{
+			/// Select the nodes that are less important than all the nodes at one or two edges from them.
+			/// Checking only the neighbors lets a node with a bad priority be contracted too early,
+			/// when its better neighbor is beaten by another node. The selected nodes have no common
+			/// neighbors, so they can be contracted at the same time.
+			const unsigned int remainingCount = (unsigned int)remaining.size();
+			ParallelFor(threadsPool, remainingCount, [&](unsigned int first, unsigned int last)
+			{
+				for (unsigned int i = first; i < last; i++)
+				{
+					unsigned int node = remaining[i];
+					const unsigned int nodeTieBreak = TieBreak(node);
+					auto isLess = [&](unsigned int other)
+					{
+						if (other == node)
+							return true;
+
+						return (priorities[node] < priorities[other])
+							|| ((priorities[node] == priorities[other]) && (nodeTieBreak < TieBreak(other) || ((nodeTieBreak == TieBreak(other)) && (node < other))));
+					};
+					auto isLessAll = [&](const std::vector<BuildEdge>& edges)
+					{
+						for (auto& edge : edges)
+						{
+							if (!isLess(edge.m_node))
+								return false;
+						}
+						return true;
+					};
+
+					bool selected = isLessAll(out[node]) && isLessAll(in[node]);
+					for (int dir = 0; selected && (dir < 2); dir++)
+					{
+						for (auto& edge : (dir == 0) ? out[node] : in[node])
+						{
+							if (!isLessAll(out[edge.m_node]) || !isLessAll(in[edge.m_node]))
+							{
+								selected = false;
+								break;
+							}
+						}
+					}
+					inRound[node] = selected ? 1 : 0;
+				}
+			});
+
+			round.clear();
+			size_t kept = 0;
+			for (auto& node : remaining)
+			{
+				if (inRound[node])
+					round.push_back(node);
+				else
+					remaining[kept++] = node;
+			}
+			remaining.resize(kept);
+
+			/// Find the shortcuts of the round in parallel. The graph is only read.
+			const unsigned int roundCount = (unsigned int)round.size();
+			ParallelFor(threadsPool, roundCount, [&](unsigned int first, unsigned int last)
+			{
+				WitnessSearch& witness = GetWitnessSearch();
+				for (unsigned int i = first; i < last; i++)
+				{
+					unsigned int node = round[i];
+					shortcuts[node].clear();
+					unsigned int hops = 0;
+					FindShortcuts(out, in, node, inRound, k_witnessHopsLimit, witness, &shortcuts[node], hops);
+				}
+			});
+
+			/// Contract the nodes of the round.
+			updated.clear();
+			for (auto& node : round)
+			{
+				ranks[node] = rank++;
+
+				/// All the remaining edges go to nodes that will be contracted later, so they are up edges.
+				up[node] = out[node];
+				down[node] = in[node];
+
+				for (int dir = 0; dir < 2; dir++)
+				{
+					for (auto& edge : (dir == 0) ? out[node] : in[node])
+					{
+						RemoveEdges((dir == 0) ? in[edge.m_node] : out[edge.m_node], node);
+						levels[edge.m_node] = std::max(levels[edge.m_node], levels[node] + 1);
+						deleted[edge.m_node]++;
+
+						if (!isUpdated[edge.m_node])
+						{
+							isUpdated[edge.m_node] = 1;
+							updated.push_back(edge.m_node);
+						}
+					}
+				}
+				out[node].clear();
+				in[node].clear();
+				out[node].shrink_to_fit();
+				in[node].shrink_to_fit();
+
+				for (auto& shortcut : shortcuts[node])
+				{
+					AddEdge(out, in, shortcut.m_from, shortcut.m_to, shortcut.m_cost, node, shortcut.m_hops);
+				}
+				m_shortcutsCount += (unsigned int)shortcuts[node].size();
+				std::vector<Shortcut>().swap(shortcuts[node]);
+			}
+
+			for (auto& node : round)
+			{
+				inRound[node] = 0;
+			}
+
+			/// Only the neighbors of the contracted nodes have a new priority.
+			const unsigned int updatedCount = (unsigned int)updated.size();
+			ParallelFor(threadsPool, updatedCount, [&](unsigned int first, unsigned int last)
+			{
+				WitnessSearch& witness = GetWitnessSearch();
+				for (unsigned int i = first; i < last; i++)
+				{
+					unsigned int node = updated[i];
+					priorities[node] = ComputePriority(out, in, levels, deleted, node, inRound, witness);
+				}
+			});
+
+			for (auto& node : updated)
+			{
+				isUpdated[node] = 0;
+			}
+		}
+
+		/// The nodes are stored from the most important to the least important, so the top of the
+		/// hierarchy, visited by all the queries, is in a small and contiguous part of the memory.
+		m_ids.resize(nodesCount);
+		m_nodes.resize(nodesCount);
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			m_ids[node] = nodesCount - 1 - ranks[node];
+			m_nodes[m_ids[node]] = node;
+		}
+
+		/// Store the up and down edges in contiguous arrays.
+		m_upOffsets.assign(nodesCount + 1, 0);
+		m_downOffsets.assign(nodesCount + 1, 0);
+		m_upEdges.clear();
+		m_upMiddles.clear();
+		m_downEdges.clear();
+		m_downMiddles.clear();
+		for (unsigned int id = 0; id < nodesCount; id++)
+		{
+			unsigned int node = m_nodes[id];
+
+			m_upOffsets[id] = (unsigned int)m_upEdges.size();
+			for (auto& edge : up[node])
+			{
+				QueryEdge queryEdge = { m_ids[edge.m_node], edge.m_cost };
+				m_upEdges.push_back(queryEdge);
+				m_upMiddles.push_back((edge.m_middle != k_noMiddle) ? m_ids[edge.m_middle] : k_noMiddle);
+			}
+
+			m_downOffsets[id] = (unsigned int)m_downEdges.size();
+			for (auto& edge : down[node])
+			{
+				QueryEdge queryEdge = { m_ids[edge.m_node], edge.m_cost };
+				m_downEdges.push_back(queryEdge);
+				m_downMiddles.push_back((edge.m_middle != k_noMiddle) ? m_ids[edge.m_middle] : k_noMiddle);
+			}
+		}
+		m_upOffsets[nodesCount] = (unsigned int)m_upEdges.size();
+		m_downOffsets[nodesCount] = (unsigned int)m_downEdges.size();
+	}
+
+	/** This is the memory used by the queries. Each thread have its own, so the queries
+	* do not allocate memory and can run in parallel.*/
+	struct QueryScratch
+	{
+		std::vector<int> m_distances[2];
+
+		/** The previous node in the search and the middle of the edge used to arrive here.*/
+		std::vector<unsigned int> m_parents[2];
+		std::vector<unsigned int> m_middles[2];
+
+		std::vector<unsigned int> m_touched[2];
+
+		/** The open lists, as heaps (see std::push_heap), so their memory is reused.*/
+		std::vector<std::pair<int, unsigned int> > m_open[2];
+
+		void Prepare(unsigned int nodesCount)
+		{
+			for (int dir = 0; dir < 2; dir++)
+			{
+				m_open[dir].clear();
+
+				if (m_distances[dir].size() != nodesCount)
+				{
+					m_distances[dir].assign(nodesCount, StaticGraph::k_unreachable);
+					m_parents[dir].resize(nodesCount);
+					m_middles[dir].resize(nodesCount);
+					m_touched[dir].clear();
+				}
+
+				for (auto& node : m_touched[dir])
+				{
+					m_distances[dir][node] = StaticGraph::k_unreachable;
+				}
+				m_touched[dir].clear();
+			}
+		}
+	};
+
+	bool ContractionHierarchy::FindPath(unsigned int startIndex, unsigned int goalIndex, std::vector<unsigned int>& path, int& cost) const
+	{
+		path.clear();
+		cost = 0;
+
+		if ((startIndex >= m_nodesCount) || (goalIndex >= m_nodesCount))
+			return false;
+
+		if (startIndex == goalIndex)
+		{
+			path.push_back(startIndex);
+			return true;
+		}
+
+		static thread_local QueryScratch scratch;
+		scratch.Prepare(m_nodesCount);
+
+		/// Direction 0 is the forward search from start, 1 is the backward search from goal.
+		/// Both go only to the nodes with a bigger rank.
+		typedef std::pair<int, unsigned int> Entry;
+		std::vector<Entry>* open[2] = { &scratch.m_open[0], &scratch.m_open[1] };
+		const std::greater<Entry> compare;
+
+		/// The search uses the ids of the nodes, see m_ids.
+		const unsigned int startId = m_ids[startIndex];
+		const unsigned int goalId = m_ids[goalIndex];
+
+		const unsigned int sources[2] = { startId, goalId };
+		for (int dir = 0; dir < 2; dir++)
+		{
+			scratch.m_distances[dir][sources[dir]] = 0;
+			scratch.m_parents[dir][sources[dir]] = sources[dir];
+			scratch.m_touched[dir].push_back(sources[dir]);
+			open[dir]->push_back(Entry(0, sources[dir]));
+		}
+
+		const unsigned int* offsets[2] = { &m_upOffsets[0], &m_downOffsets[0] };
+		const QueryEdge* edges[2] = { m_upEdges.data(), m_downEdges.data() };
+		const std::vector<unsigned int>* middles[2] = { &m_upMiddles, &m_downMiddles };
+
+		int best = StaticGraph::k_unreachable;
+		unsigned int meeting = m_nodesCount;
+
+		int dir = 0;
+		while (!open[0]->empty() || !open[1]->empty())
+		{
+			/// Alternate the directions, but skip the one that is finished.
+			if (open[dir]->empty())
+				dir = 1 - dir;
+
+			std::pop_heap(open[dir]->begin(), open[dir]->end(), compare);
+			Entry entry = open[dir]->back();
+			open[dir]->pop_back();
+
+			std::vector<int>& distances = scratch.m_distances[dir];
+			if (entry.first > distances[entry.second])
+			{
+				dir = 1 - dir;
+				continue;
+			}
+
+			/// Nothing better can be found in this direction.
+			if (entry.first >= best)
+			{
+				open[dir]->clear();
+				dir = 1 - dir;
+				continue;
+			}
+
+			/// Check if the other search have reached this node.
+			int other = scratch.m_distances[1 - dir][entry.second];
+			if ((other != StaticGraph::k_unreachable) && (entry.first + other < best))
+			{
+				best = entry.first + other;
+				meeting = entry.second;
+			}
+
+			/// Stall on demand: if a more important node already reached by this search gives a
+			/// shorter distance to this node, the node is not on a shortest path, so do not expand it.
+			bool stalled = false;
+			for (unsigned int e = offsets[1 - dir][entry.second]; e < offsets[1 - dir][entry.second + 1]; e++)
+			{
+				int higher = distances[edges[1 - dir][e].m_node];
+				if ((higher != StaticGraph::k_unreachable) && (higher + edges[1 - dir][e].m_cost < entry.first))
+				{
+					stalled = true;
+					break;
+				}
+			}
+
+			if (stalled)
+			{
+				dir = 1 - dir;
+				continue;
+			}
+
+			for (unsigned int e = offsets[dir][entry.second]; e < offsets[dir][entry.second + 1]; e++)
+			{
+				unsigned int next = edges[dir][e].m_node;
+				int dist = entry.first + edges[dir][e].m_cost;
+				if (dist < distances[next])
+				{
+					if (distances[next] == StaticGraph::k_unreachable)
+						scratch.m_touched[dir].push_back(next);
+
+					distances[next] = dist;
+					scratch.m_parents[dir][next] = entry.second;
+					scratch.m_middles[dir][next] = (*middles[dir])[e];
+					open[dir]->push_back(Entry(dist, next));
+					std::push_heap(open[dir]->begin(), open[dir]->end(), compare);
+				}
+			}
+
+			dir = 1 - dir;
+		}
+
+		if (meeting == m_nodesCount)
+			return false;
+
+		cost = best;
+
+		/// Collect the edges of the forward search, from meeting node down to start.
+		std::vector<unsigned int> chain;
+		for (unsigned int node = meeting; node != startId; node = scratch.m_parents[0][node])
+		{
+			chain.push_back(node);
+		}
+
+		/// Unpack them in the forward order: start -> meeting node.
+		path.push_back(startId);
+		unsigned int from = startId;
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+		{
+			UnpackEdge(from, *it, scratch.m_middles[0][*it], path);
+			from = *it;
+		}
+
+		/// And the edges of the backward search: meeting node -> goal.
+		for (unsigned int node = meeting; node != goalId; node = scratch.m_parents[1][node])
+		{
+			UnpackEdge(node, scratch.m_parents[1][node], scratch.m_middles[1][node], path);
+		}
+
+		for (auto& node : path)
+		{
+			node = m_nodes[node];
+		}
+
+		/// Use the same order as the A* search: goal -> start.
+		std::reverse(path.begin(), path.end());
+		return true;
+	}
+
+	unsigned int ContractionHierarchy::GetEdgeMiddle(unsigned int fromIndex, unsigned int toIndex) const
+	{
+		/// The edge is stored in the list of the node with the smaller rank (the bigger id).
+		if (fromIndex > toIndex)
+		{
+			for (unsigned int e = m_upOffsets[fromIndex]; e < m_upOffsets[fromIndex + 1]; e++)
+			{
+				if (m_upEdges[e].m_node == toIndex)
+					return m_upMiddles[e];
+			}
+		}
+		else
+		{
+			for (unsigned int e = m_downOffsets[toIndex]; e < m_downOffsets[toIndex + 1]; e++)
+			{
+				if (m_downEdges[e].m_node == fromIndex)
+					return m_downMiddles[e];
+			}
+		}
+
+		return k_noMiddle;
+	}
+
+	void ContractionHierarchy::UnpackEdge(unsigned int fromIndex, unsigned int toIndex, unsigned int middle, std::vector<unsigned int>& path) const
+	{
+		/// The shortcuts are replaced with the two edges they are made of, until only
+		/// original edges remain. A stack is used because the shortcuts can be nested very deep.
+		typedef std::pair<unsigned int, unsigned int> Edge;
+		std::vector<std::pair<Edge, unsigned int> > stack;
+		stack.push_back(std::make_pair(Edge(fromIndex, toIndex), middle));
+
+		while (!stack.empty())
+		{
+			Edge edge = stack.back().first;
+			unsigned int edgeMiddle = stack.back().second;
+			stack.pop_back();
+
+			if (edgeMiddle == k_noMiddle)
+			{
+				path.push_back(edge.second);
+				continue;
+			}
+
+			/// The second half is pushed first, so the first half is unpacked first.
+			stack.push_back(std::make_pair(Edge(edgeMiddle, edge.second), GetEdgeMiddle(edgeMiddle, edge.second)));
+			stack.push_back(std::make_pair(Edge(edge.first, edgeMiddle), GetEdgeMiddle(edge.first, edgeMiddle)));
+		}
+	}
+} //namespace fpe
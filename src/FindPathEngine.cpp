@@ -1,8 +1,20 @@
 
 #include "FindPathEngine/FindPathEngine.h"
+#include "FindPathEngine/Landmarks.h"
+#include "FindPathEngine/StaticGraph.h"
+#include "FindPathEngine/ContractionHierarchy.h"
+#include "FindPathEngine/Batch.h"
+#include "FindPathEngine/ReservationTable.h"
+#include "FindPathEngine/PathPostProcess.h"
+
+#include "ParallelSearch.h"
 
 #include "ThreadPool/ThreadPool.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <climits>
+
 
 namespace fpe
 {
@@ -10,6 +22,10 @@ namespace fpe
 		: m_navMesh(navMesh)
 		, m_threadsCount(threadsCount)
 		, m_threadsPool(nullptr)
+		, m_landmarks(nullptr)
+		, m_heuristicMode(HeuristicMode::NAVMESH)
+		, m_hierarchy(nullptr)
+		, m_reservations(nullptr)
 	{
 		if (m_threadsCount > 0)
 			m_threadsPool = new tp::ThreadPool(m_threadsCount);
@@ -29,6 +45,8 @@ namespace fpe
         {
             ticket->Stop();
         }
+        std::vector<std::weak_ptr<Batch> > batches;
+        batches.swap(m_batches);
         m_ticketsMutex.unlock();
 
         while (true)
@@ -39,10 +57,310 @@ namespace fpe
             if (m_tickets.size() == 0)
                 break;
         }
+
+        /// The chunks not started will be marked as stopped. Wait the chunks in progress.
+        for (auto& weakBatch : batches)
+        {
+            auto batch = weakBatch.lock();
+            if (batch != nullptr)
+            {
+                batch->Stop();
+                batch->Wait();
+            }
+        }
     }
 
+	/** This is the memory used by the searches of a batch chunk. Is reused for all
+	* the requests of the chunk, so the searches do not allocate memory again and again.*/
+	struct BatchScratch
+	{
+		struct Record
+		{
+			/** "G" */
+			int m_cost;
+
+			unsigned int m_parent;
+
+			bool m_closed;
+		};
+
+		std::unordered_map<unsigned int, Record> m_nodes;
+
+		/** Is a heap of ("F", node). The smallest "F" is on top. */
+		std::vector<std::pair<int, unsigned int> > m_openList;
+	};
+
+	/** This is the A* search used by the batches. Unlike ProcessTicket, the whole search is done in one call.
+	* @param path is filled with the nodes of the path, from start to goal.
+	* @return false if there is no path.*/
+	template <typename Heuristic>
+	static bool FindBatchPath(NavMeshBase* navMesh, Heuristic& heuristic, unsigned int startIndex, unsigned int goalIndex,
+		BatchScratch& scratch, std::vector<unsigned int>& path)
+	{
+		typedef std::pair<int, unsigned int> Entry;
+		std::greater<Entry> compare;
+
+		path.clear();
+		scratch.m_nodes.clear();
+		scratch.m_openList.clear();
+
+		BatchScratch::Record start = { 0, startIndex, false };
+		scratch.m_nodes[startIndex] = start;
+		scratch.m_openList.push_back(Entry(heuristic(goalIndex, startIndex), startIndex));
+
+		while (!scratch.m_openList.empty())
+		{
+			std::pop_heap(scratch.m_openList.begin(), scratch.m_openList.end(), compare);
+			unsigned int nodeIndex = scratch.m_openList.back().second;
+			scratch.m_openList.pop_back();
+
+			BatchScratch::Record& record = scratch.m_nodes[nodeIndex];
+			if (record.m_closed)
+				continue;
+			record.m_closed = true;
+
+			if (nodeIndex == goalIndex)
+			{
+				/// Follow the parents back to start, then reverse.
+				for (unsigned int node = goalIndex; node != startIndex; node = scratch.m_nodes[node].m_parent)
+				{
+					path.push_back(node);
+				}
+				path.push_back(startIndex);
+				std::reverse(path.begin(), path.end());
+				return true;
+			}
+
+			int cost = record.m_cost;
+			for (auto& neighbor : navMesh->GetNeighbors(nodeIndex))
+			{
+				int neighborCost = cost + navMesh->ComputeCost(nodeIndex, neighbor);
+
+				auto it = scratch.m_nodes.find(neighbor);
+				if (it == scratch.m_nodes.end())
+				{
+					BatchScratch::Record added = { neighborCost, nodeIndex, false };
+					scratch.m_nodes[neighbor] = added;
+				}
+				else if (neighborCost < it->second.m_cost)
+				{
+					it->second.m_cost = neighborCost;
+					it->second.m_parent = nodeIndex;
+					it->second.m_closed = false;
+				}
+				else
+				{
+					continue;
+				}
+
+				scratch.m_openList.push_back(Entry(neighborCost + heuristic(goalIndex, neighbor), neighbor));
+				std::push_heap(scratch.m_openList.begin(), scratch.m_openList.end(), compare);
+			}
+		}
+
+		return false;
+	}
+
+	std::shared_ptr<Batch> FindPathEngine::AddBatch(const std::vector<unsigned int>& startIndexes, const std::vector<unsigned int>& goalIndexes, unsigned int chunkSize)
+	{
+		std::shared_ptr<Batch> batch = std::make_shared<Batch>(startIndexes, goalIndexes, chunkSize);
+
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_ticketsMutex);
+
+			/// Forget the batches that are done.
+			m_batches.erase(std::remove_if(m_batches.begin(), m_batches.end(),
+				[](const std::weak_ptr<Batch>& weakBatch)
+				{
+					auto old = weakBatch.lock();
+					return (old == nullptr) || old->IsDone();
+				}), m_batches.end());
+
+			m_batches.push_back(batch);
+		}
+
+		for (unsigned int chunk = 0; chunk < (unsigned int)batch->m_chunkNodes.size(); chunk++)
+		{
+			if (m_threadsPool != nullptr)
+				m_threadsPool->AddJob(std::bind(&FindPathEngine::ProcessBatchChunk, this->shared_from_this(), batch, chunk));
+			else
+				ProcessBatchChunk(batch, chunk);
+		}
+
+		return batch;
+	}
+
+	void FindPathEngine::ProcessBatchChunk(std::shared_ptr<Batch> batch, unsigned int chunkIndex)
+	{
+		const unsigned int first = chunkIndex * batch->m_chunkSize;
+		const unsigned int last = std::min(first + batch->m_chunkSize, batch->GetCount());
+
+		auto navMesh = m_navMesh.lock();
+		auto landmarks = std::atomic_load(&m_landmarks);
+		auto hierarchy = std::atomic_load(&m_hierarchy);
+
+		auto heuristic = [this, &navMesh, &landmarks](unsigned int goalIndex, unsigned int nodeIndex)
+		{
+			return ComputeGoalDistanceEstimate(navMesh.get(), landmarks.get(), goalIndex, nodeIndex);
+		};
+
+		BatchScratch scratch;
+		std::vector<unsigned int> path;
+		std::vector<unsigned int>& nodes = batch->m_chunkNodes[chunkIndex];
+
+		for (unsigned int i = first; i < last; i++)
+		{
+			if (batch->m_mustStop || (navMesh == nullptr))
+			{
+				batch->m_statuses[i] = Batch::Status::STOPPED;
+				continue;
+			}
+
+			bool found = false;
+			if (hierarchy != nullptr)
+			{
+				int cost = 0;
+				found = hierarchy->FindPath(batch->m_startIndexes[i], batch->m_goalIndexes[i], path, cost);
+
+				/// The hierarchy gives the path from goal to start.
+				std::reverse(path.begin(), path.end());
+			}
+			else
+			{
+				found = FindBatchPath(navMesh.get(), heuristic, batch->m_startIndexes[i], batch->m_goalIndexes[i], scratch, path);
+			}
+
+			/// The offset is relative to the chunk buffer until all the chunks are done.
+			batch->m_offsets[i] = (unsigned int)nodes.size();
+			batch->m_lengths[i] = (unsigned int)path.size();
+			batch->m_statuses[i] = found ? Batch::Status::FOUND : Batch::Status::NOT_FOUND;
+			nodes.insert(nodes.end(), path.begin(), path.end());
+		}
+
+		/// Only the last chunk goes further.
+		if (--batch->m_pendingChunks > 0)
+			return;
+
+		/// Now the size of each chunk is known, so is known where each chunk goes in the buffer.
+		std::vector<unsigned int> bases(batch->m_chunkNodes.size());
+		size_t total = 0;
+		for (unsigned int chunk = 0; chunk < (unsigned int)batch->m_chunkNodes.size(); chunk++)
+		{
+			bases[chunk] = (unsigned int)total;
+			total += batch->m_chunkNodes[chunk].size();
+		}
+		batch->m_pathNodes.resize(total);
+
+		/// Each chunk is copied by its own job. This one copy the last chunk.
+		const unsigned int lastChunk = (unsigned int)batch->m_chunkNodes.size() - 1;
+		for (unsigned int chunk = 0; chunk < lastChunk; chunk++)
+		{
+			if (m_threadsPool != nullptr)
+				m_threadsPool->AddJob(std::bind(&FindPathEngine::MergeBatchChunk, this->shared_from_this(), batch, chunk, bases[chunk]));
+			else
+				MergeBatchChunk(batch, chunk, bases[chunk]);
+		}
+		MergeBatchChunk(batch, lastChunk, bases[lastChunk]);
+	}
+
+	void FindPathEngine::MergeBatchChunk(std::shared_ptr<Batch> batch, unsigned int chunkIndex, unsigned int base)
+	{
+		const unsigned int first = chunkIndex * batch->m_chunkSize;
+		const unsigned int last = std::min(first + batch->m_chunkSize, batch->GetCount());
+		for (unsigned int i = first; i < last; i++)
+		{
+			batch->m_offsets[i] += base;
+		}
+
+		std::vector<unsigned int>& nodes = batch->m_chunkNodes[chunkIndex];
+		std::copy(nodes.begin(), nodes.end(), batch->m_pathNodes.begin() + base);
+		std::vector<unsigned int>().swap(nodes);
+
+		/// Only the last chunk copied goes further.
+		if (--batch->m_pendingMerges > 0)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(batch->m_doneMutex);
+			batch->m_done = true;
+		}
+		batch->m_doneCondition.notify_all();
+	}
+
+
+	std::shared_ptr<Landmarks> FindPathEngine::ComputeLandmarks(unsigned int nodesCount, unsigned int landmarksCount)
+	{
+		/// Take a snapshot of the navmesh, so the searches do not call the navmesh.
+		StaticGraph graph;
+		if (!graph.Build(m_navMesh, nodesCount))
+			return nullptr;
+
+		std::shared_ptr<Landmarks> landmarks = std::make_shared<Landmarks>();
+		if (!landmarks->Compute(graph, landmarksCount, m_threadsPool))
+			return nullptr;
+
+		return landmarks;
+	}
+
+	bool FindPathEngine::SetLandmarks(std::shared_ptr<Landmarks> landmarks, HeuristicMode mode, unsigned int nodesCount)
+	{
+		if ((landmarks != nullptr) && (landmarks->GetNodesCount() != nodesCount))
+			return false;
+
+		std::atomic_store(&m_landmarks, landmarks);
+		m_heuristicMode = mode;
+		return true;
+	}
+
+	std::shared_ptr<ContractionHierarchy> FindPathEngine::ComputeContractionHierarchy(unsigned int nodesCount)
+	{
+		StaticGraph graph;
+		if (!graph.Build(m_navMesh, nodesCount))
+			return nullptr;
+
+		std::shared_ptr<ContractionHierarchy> hierarchy = std::make_shared<ContractionHierarchy>();
+		hierarchy->Build(graph, m_threadsPool);
+		return hierarchy;
+	}
+
+	void FindPathEngine::SetContractionHierarchy(std::shared_ptr<ContractionHierarchy> hierarchy)
+	{
+		std::atomic_store(&m_hierarchy, hierarchy);
+	}
+
+	void FindPathEngine::SetReservationTable(std::shared_ptr<ReservationTable> reservations)
+	{
+		std::atomic_store(&m_reservations, reservations);
+	}
+
+	int FindPathEngine::ComputeGoalDistanceEstimate(NavMeshBase* navMesh, Landmarks* landmarks, unsigned int goalIndex, unsigned int nodeIndex)
+	{
+		HeuristicMode mode = m_heuristicMode;
+
+		/// Without landmarks only the navmesh can tell.
+		if ((landmarks == nullptr) || (mode == HeuristicMode::NAVMESH))
+			return navMesh->ComputeGoalDistanceEstimate(goalIndex, nodeIndex);
+
+		int estimate = landmarks->ComputeGoalDistanceEstimate(goalIndex, nodeIndex);
+		if (mode == HeuristicMode::MAX)
+			estimate = std::max(estimate, navMesh->ComputeGoalDistanceEstimate(goalIndex, nodeIndex));
+
+		return estimate;
+	}
+
+	void FindPathEngine::PostProcessTicket(Ticket* ticket, NavMeshBase* navMesh)
+	{
+		if (!ticket->m_postProcess)
+			return;
+
+		PathPostProcess::BuildWaypoints(navMesh, ticket->m_pathFound, ticket->m_stringPulling, ticket->m_removeCollinear, ticket->m_waypoints);
 
-	Ticket::Ticket(unsigned int startIndex, unsigned int goalIndex, bool runAsync)
+		if (ticket->m_encodeWaypoints)
+			PathPostProcess::EncodeWaypoints(ticket->m_waypoints, ticket->m_encodedWaypoints);
+	}
+
+
+	Ticket::Ticket(unsigned int startIndex, unsigned int goalIndex, bool runAsync, bool runParallel)
 		: m_startIndex(startIndex)
 		, m_goalIndex(goalIndex)
 		, m_current(nullptr)
@@ -51,7 +369,57 @@ namespace fpe
 		, m_mustStop(false)
 		, m_runAsync(runAsync)
 		, m_runAsyncQueued(false)
+		, m_runParallel(runParallel)
+		, m_cooperative(false)
+		, m_agentId(0)
+		, m_startTime(0)
+		, m_window(0)
+		, m_waitCost(0)
+		, m_postProcess(false)
+		, m_stringPulling(false)
+		, m_removeCollinear(false)
+		, m_encodeWaypoints(false)
+	{
+	}
+
+	void Ticket::SetCooperative(unsigned int agentId, unsigned int startTime, unsigned int window, int waitCost)
 	{
+		m_agentId = agentId;
+		m_startTime = startTime;
+		m_window = (window > 0) ? window : 1;
+		m_waitCost = waitCost;
+		m_cooperative = true;
+	}
+
+	bool Ticket::GetCooperative(unsigned int& agentId, unsigned int& startTime, unsigned int& window, int& waitCost)
+	{
+		if (!m_cooperative)
+			return false;
+
+		agentId = m_agentId;
+		startTime = m_startTime;
+		window = m_window;
+		waitCost = m_waitCost;
+		return true;
+	}
+
+	void Ticket::SetPostProcess(bool stringPulling, bool removeCollinear, bool encode)
+	{
+		m_stringPulling = stringPulling;
+		m_removeCollinear = removeCollinear;
+		m_encodeWaypoints = encode;
+		m_postProcess = true;
+	}
+
+	bool Ticket::GetPostProcess(bool& stringPulling, bool& removeCollinear, bool& encode)
+	{
+		if (!m_postProcess)
+			return false;
+
+		stringPulling = m_stringPulling;
+		removeCollinear = m_removeCollinear;
+		encode = m_encodeWaypoints;
+		return true;
 	}
 
 	std::vector<unsigned int>& Ticket::GetFoundPath()
@@ -61,6 +429,20 @@ namespace fpe
 		return m_pathFound;
 	}
 
+	std::vector<unsigned int>& Ticket::GetWaypoints()
+	{
+		/// protect the m_waypoints for multithread access
+		std::lock_guard<std::mutex> lock(m_pathFoundMutex);
+		return m_waypoints;
+	}
+
+	std::vector<unsigned char>& Ticket::GetEncodedWaypoints()
+	{
+		/// protect the m_encodedWaypoints for multithread access
+		std::lock_guard<std::mutex> lock(m_pathFoundMutex);
+		return m_encodedWaypoints;
+	}
+
 	std::map<unsigned int, std::shared_ptr<Node> > Ticket::GetOpenList()
 	{ 
 		/// protect the m_openList for multithread access
@@ -124,7 +506,18 @@ namespace fpe
 				{
 					/// If the ticket was not already started, Add a job to the thread pool.
                     ticket->m_runAsyncQueued = true;
-                    m_threadsPool->AddJob(std::bind(&FindPathEngine::ProcessTicketAsync, this->shared_from_this(), ticket));
+
+					/// A parallel ticket and a hierarchy query do not go well together:
+					/// the query is already fast, so run it as a normal async ticket.
+					if (ticket->m_runParallel && !ticket->m_cooperative && (m_threadsCount > 1) && (std::atomic_load(&m_hierarchy) == nullptr))
+					{
+						/// If this is the only ticket, use the whole pool.
+						StartTicketParallel(ticket, (m_tickets.size() == 1) ? m_threadsCount : std::max(m_threadsCount / 2, 2u));
+					}
+					else
+					{
+						m_threadsPool->AddJob(std::bind(&FindPathEngine::ProcessTicketAsync, this->shared_from_this(), ticket));
+					}
 				}
 				else
 				{
@@ -163,13 +556,248 @@ namespace fpe
 		}
 	}
 
+	/** How many times a cooperative ticket is searched again, when another ticket
+	* reserved a node of its path before this one could reserve it.*/
+	static const unsigned int k_cooperativeAttempts = 4;
+
+	/** This is a state of the cooperative search. */
+	struct SpaceTimeRecord
+	{
+		/** "G" */
+		int m_cost;
+
+		/** The key of the parent state */
+		uint64_t m_parent;
+
+		bool m_closed;
+	};
+
+	void FindPathEngine::ProcessTicketCooperative(std::shared_ptr<Ticket> ticket, NavMeshBase* navMesh, Landmarks* landmarks, ReservationTable* reservations)
+	{
+		const unsigned int agentId = ticket->m_agentId;
+		const unsigned int startTime = ticket->m_startTime;
+		const unsigned int window = ticket->m_window;
+		const unsigned int goalIndex = ticket->m_goalIndex;
+
+		/// The key of a state is (time << 32) | node. The time is relative to startTime.
+		auto getKey = [](unsigned int nodeIndex, unsigned int time) { return ((uint64_t)time << 32) | nodeIndex; };
+
+		/// The old reservations of this agent are kept until the new path is reserved,
+		/// so the other agents do not plan over the agent while it searches.
+		typedef std::pair<int, uint64_t> Entry;
+		std::greater<Entry> compare;
+		std::unordered_map<uint64_t, SpaceTimeRecord> states;
+		std::vector<Entry> openList;
+		std::vector<unsigned int> path;
+
+		/// Another agent is on the start node, so no path can start from there.
+		bool startFree = reservations->IsFree(agentId, ticket->m_startIndex, startTime);
+
+		for (unsigned int attempt = 0; startFree && (attempt < k_cooperativeAttempts); attempt++)
+		{
+			if (ticket->m_mustStop)
+				break;
+
+			states.clear();
+			openList.clear();
+			path.clear();
+
+			uint64_t startKey = getKey(ticket->m_startIndex, 0);
+			SpaceTimeRecord start = { 0, startKey, false };
+			states[startKey] = start;
+			openList.push_back(Entry(ComputeGoalDistanceEstimate(navMesh, landmarks, goalIndex, ticket->m_startIndex), startKey));
+
+			while (!openList.empty())
+			{
+				std::pop_heap(openList.begin(), openList.end(), compare);
+				uint64_t key = openList.back().second;
+				openList.pop_back();
+
+				SpaceTimeRecord& record = states[key];
+				if (record.m_closed)
+					continue;
+				record.m_closed = true;
+				ticket->m_steps++;
+
+				unsigned int nodeIndex = (unsigned int)(key & 0xFFFFFFFF);
+				unsigned int time = (unsigned int)(key >> 32);
+
+				/// The search ends on the goal, if the agent can stay there until the end of
+				/// the window, or on the last step of the window.
+				bool done = (time == window);
+				if (nodeIndex == goalIndex)
+				{
+					done = true;
+					for (unsigned int t = time + 1; (t <= window) && done; t++)
+					{
+						done = reservations->IsFree(agentId, goalIndex, startTime + t);
+					}
+				}
+
+				if (done)
+				{
+					/// Follow the parents back to start. Each time step have a node.
+					for (uint64_t state = key; state != startKey; state = states[state].m_parent)
+					{
+						path.push_back((unsigned int)(state & 0xFFFFFFFF));
+					}
+					path.push_back(ticket->m_startIndex);
+					std::reverse(path.begin(), path.end());
+					break;
+				}
+
+				/// The agent can move to a neighbor or can wait.
+				std::vector<unsigned int> nextNodes = navMesh->GetNeighbors(nodeIndex);
+				nextNodes.push_back(nodeIndex);
+
+				const unsigned int nextTime = startTime + time + 1;
+				for (auto& nextIndex : nextNodes)
+				{
+					if (!reservations->IsFree(agentId, nextIndex, nextTime))
+						continue;
+
+					/// Two agents cannot swap their nodes.
+					if (nextIndex != nodeIndex)
+					{
+						unsigned int other = reservations->GetOwner(nextIndex, nextTime - 1);
+						if ((other != ReservationTable::k_noAgent) && (other != agentId)
+							&& (reservations->GetOwner(nodeIndex, nextTime) == other))
+							continue;
+					}
+
+					int cost = record.m_cost + ((nextIndex == nodeIndex) ? ticket->m_waitCost : navMesh->ComputeCost(nodeIndex, nextIndex));
+
+					uint64_t nextKey = getKey(nextIndex, time + 1);
+					auto it = states.find(nextKey);
+					if (it == states.end())
+					{
+						SpaceTimeRecord added = { cost, key, false };
+						states[nextKey] = added;
+					}
+					else if (cost < it->second.m_cost)
+					{
+						it->second.m_cost = cost;
+						it->second.m_parent = key;
+						it->second.m_closed = false;
+					}
+					else
+					{
+						continue;
+					}
+
+					openList.push_back(Entry(cost + ComputeGoalDistanceEstimate(navMesh, landmarks, goalIndex, nextIndex), nextKey));
+					std::push_heap(openList.begin(), openList.end(), compare);
+				}
+			}
+
+			/// There is no path in the window, not even waiting.
+			if (path.empty())
+				break;
+
+			/// The agent stays on the last node until the end of the window.
+			std::vector<unsigned int> reserved = path;
+			while (reserved.size() <= window)
+				reserved.push_back(path.back());
+
+			/// If another ticket reserved a node meanwhile, search again.
+			if (!reservations->ReplacePath(agentId, reserved, startTime))
+			{
+				path.clear();
+				continue;
+			}
+
+			break;
+		}
+
+		/// No path was found: the agent waits on the start node for the window, if nobody else
+		/// reserved it. Else the old reservations of the agent are kept.
+		if (path.empty() && startFree && !ticket->m_mustStop)
+		{
+			std::vector<unsigned int> waiting(window + 1, ticket->m_startIndex);
+			if (reservations->ReplacePath(agentId, waiting, startTime))
+				path = waiting;
+		}
+
+		/// protect the m_pathFound for multithread access
+		std::lock_guard<std::mutex> lock(ticket->m_pathFoundMutex);
+
+		if (path.empty())
+		{
+			ticket->m_state = Ticket::State::STOPPED;
+			return;
+		}
+
+		/// Use the same order as the A* search: goal -> start.
+		/// There is no post process, because each node is a time step.
+		ticket->m_pathFound.assign(path.rbegin(), path.rend());
+		ticket->m_state = Ticket::State::COMPLETED;
+	}
+
+	void FindPathEngine::StartTicketParallel(std::shared_ptr<Ticket> ticket, unsigned int jobsCount)
+	{
+		ticket->m_state = Ticket::State::PROCESSING;
+
+		/// The jobs use the same heuristic as ProcessTicket. The engine and the navmesh are locked once
+		/// for the whole search, not at each call: the search is short, and the jobs keep the engine alive anyway.
+		std::shared_ptr<NavMeshBase> navMesh = m_navMesh.lock();
+		std::shared_ptr<Landmarks> landmarks = std::atomic_load(&m_landmarks);
+		std::shared_ptr<FindPathEngine> engine = this->shared_from_this();
+		auto heuristic = [engine, navMesh, landmarks](unsigned int goalIndex, unsigned int nodeIndex)
+		{
+			if (navMesh == nullptr)
+				return 0;
+
+			return engine->ComputeGoalDistanceEstimate(navMesh.get(), landmarks.get(), goalIndex, nodeIndex);
+		};
+
+		std::shared_ptr<ParallelSearch> search = std::make_shared<ParallelSearch>(m_navMesh, heuristic,
+			ticket->m_startIndex, ticket->m_goalIndex, jobsCount);
+
+		for (unsigned int i = 0; i < jobsCount; i++)
+		{
+			m_threadsPool->AddJob(std::bind(&FindPathEngine::ProcessTicketParallel, this->shared_from_this(), std::weak_ptr<Ticket>(ticket), search));
+		}
+	}
+
+	void FindPathEngine::ProcessTicketParallel(std::weak_ptr<Ticket> weakTicket, std::shared_ptr<ParallelSearch> search)
+	{
+		auto ticket = weakTicket.lock();
+		if (ticket == nullptr)
+		{
+			/// Nobody waits for the path, because the ticket is destroied.
+			search->Stop();
+		}
+
+		/// Only the last job that finish will go further.
+		if (!search->Run((ticket != nullptr) ? &ticket->m_mustStop : nullptr))
+			return;
+
+		if (ticket == nullptr)
+			return;
+
+		ticket->m_steps = search->GetSteps();
+
+		{
+			/// protect the m_pathFound for multithread access
+			std::lock_guard<std::mutex> lock(ticket->m_pathFoundMutex);
+
+			if (search->GetPath(ticket->m_pathFound))
+			{
+				auto navMesh = m_navMesh.lock();
+				PostProcessTicket(ticket.get(), navMesh.get());
+				ticket->m_state = Ticket::State::COMPLETED;
+			}
+			else
+				ticket->m_state = Ticket::State::STOPPED;
+		}
+	}
+
     bool FindPathEngine::ProcessTicket(std::weak_ptr<Ticket> weakTicket)
 	{
         auto ticket = weakTicket.lock();
         if (ticket == nullptr)
         {
-            /// Search is stopped because the ticket is destroied.
-            ticket->m_state = Ticket::State::STOPPED;
+            /// Search is stopped because the ticket is destroied. Nobody can read its state.
             return true;
         }
 		ticket->m_state = Ticket::State::PROCESSING;
@@ -192,6 +820,17 @@ namespace fpe
             return true;
         }
 
+		/// Keep the landmarks alive for this step, even if SetLandmarks() is called meanwhile.
+		auto landmarks = std::atomic_load(&m_landmarks);
+
+		/// The cooperative tickets are searched in the (node, time) space, in one step.
+		auto reservations = std::atomic_load(&m_reservations);
+		if (ticket->m_cooperative && (reservations != nullptr))
+		{
+			ProcessTicketCooperative(ticket, navMesh.get(), landmarks.get(), reservations.get());
+			return true;
+		}
+
 		/// Chekc if the m_start is the same with m_goalIndex
 		if (ticket->m_startIndex == ticket->m_goalIndex)
 		{
@@ -199,12 +838,32 @@ namespace fpe
 			std::lock_guard<std::mutex> lock(ticket->m_pathFoundMutex);
 
 			ticket->m_pathFound.push_back(ticket->m_startIndex);
+			PostProcessTicket(ticket.get(), navMesh.get());
 
 			/// Search is stopped because the goal si the same with start node
 			ticket->m_state = Ticket::State::COMPLETED;
 			return true;
 		}
 
+		/// If the navmesh is static and the hierarchy was built, one query is enough.
+		auto hierarchy = std::atomic_load(&m_hierarchy);
+		if (hierarchy != nullptr)
+		{
+			/// protect the m_pathFound for multithread access
+			std::lock_guard<std::mutex> lock(ticket->m_pathFoundMutex);
+
+			int cost = 0;
+			if (hierarchy->FindPath(ticket->m_startIndex, ticket->m_goalIndex, ticket->m_pathFound, cost))
+			{
+				PostProcessTicket(ticket.get(), navMesh.get());
+				ticket->m_state = Ticket::State::COMPLETED;
+			}
+			else
+				ticket->m_state = Ticket::State::STOPPED;
+
+			return true;
+		}
+
 		/// protect the m_closedList for multithread access
 		{
 			std::lock_guard<std::mutex> lock(ticket->m_closedListMutex);
@@ -219,7 +878,7 @@ namespace fpe
 				start->m_parent = nullptr;
 
 				/// calculate the distance to target
-                start->m_distToTarget = navMesh->ComputeGoalDistanceEstimate(ticket->m_goalIndex, ticket->m_startIndex);
+                start->m_distToTarget = ComputeGoalDistanceEstimate(navMesh.get(), landmarks.get(), ticket->m_goalIndex, ticket->m_startIndex);
 
 				/// calculate the cost to travel from m_startIndex node to the neighbor note
 				start->m_cost = 0;
@@ -260,6 +919,7 @@ namespace fpe
 					node = node->m_parent;
 				} while (node != nullptr);
 
+				PostProcessTicket(ticket.get(), navMesh.get());
 				ticket->m_state = Ticket::State::COMPLETED;
 				return true;
 			}
@@ -294,7 +954,7 @@ namespace fpe
 
 
 			/// calculate the distance to target
-            neigh->m_distToTarget = navMesh->ComputeGoalDistanceEstimate(ticket->m_goalIndex, neighbor);
+            neigh->m_distToTarget = ComputeGoalDistanceEstimate(navMesh.get(), landmarks.get(), ticket->m_goalIndex, neighbor);
 
 			/// calculate the cost to travel from m_startIndex node to the neighbor note
             neigh->m_cost = navMesh->ComputeCost(ticket->m_current->m_index, neighbor);
@@ -0,0 +1,78 @@
+#ifndef JOBSGROUP_H
+#define JOBSGROUP_H
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "ThreadPool/ThreadPool.h"
+
+
+namespace fpe
+{
+	/** This is an internal helper used to run a set of jobs on the threads pool
+	* and to wait until all of them are done. Wait() must not be called from a pool thread.*/
+	class JobsGroup
+	{
+	public:
+
+		/** The constructor.
+		* @param threadsPool is the pool that will run the jobs. If is null the jobs run on the caller thread.*/
+		JobsGroup(tp::ThreadPool* threadsPool)
+			: m_threadsPool(threadsPool)
+			, m_pending(0)
+		{
+		}
+
+		/** The destructor waits the jobs, because they may still use this object.*/
+		~JobsGroup()
+		{
+			Wait();
+		}
+
+		/** Run the job on the threads pool, or right now if there is no pool. */
+		void AddJob(std::function<void()> job)
+		{
+			if (m_threadsPool == nullptr)
+			{
+				job();
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_pending++;
+			}
+
+			m_threadsPool->AddJob([this, job]()
+			{
+				job();
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (--m_pending == 0)
+					m_done.notify_all();
+			});
+		}
+
+		/** Block the caller until all the jobs added are done. */
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock, [this]() { return m_pending == 0; });
+		}
+
+	private:
+
+		tp::ThreadPool* m_threadsPool;
+
+		/** How many jobs are not done yet */
+		unsigned int m_pending;
+
+		std::mutex m_mutex;
+
+		std::condition_variable m_done;
+	};
+
+} // namespace fpe
+
+#endif //JOBSGROUP_H
@@ -0,0 +1,256 @@
+
+#include "FindPathEngine/Landmarks.h"
+#include "FindPathEngine/StaticGraph.h"
+
+#include "JobsGroup.h"
+
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace fpe
+{
+	/** The first bytes of the file written by Landmarks::Save */
+	static const char k_landmarksFileMagic[4] = { 'F', 'P', 'E', 'L' };
+
+	/** Increment this when the file layout is changed */
+	static const uint32_t k_landmarksFileVersion = 1;
+
+	/** A file with more landmarks is not valid. Each landmark makes the heuristic slower,
+	* so a real use never needs so many.*/
+	static const uint32_t k_maxLandmarksCount = 1024;
+
+
+	Landmarks::Landmarks()
+		: m_nodesCount(0)
+	{
+	}
+
+	bool Landmarks::Compute(const StaticGraph& graph, unsigned int landmarksCount, tp::ThreadPool* threadsPool)
+	{
+		const unsigned int nodesCount = graph.GetNodesCount();
+
+		m_nodesCount = 0;
+		m_landmarks.clear();
+		m_fromLandmark.clear();
+		m_toLandmark.clear();
+
+		/// The first landmark is searched from a node that have neighbors,
+		/// so the walls (nodes without edges) are not used.
+		unsigned int root = nodesCount;
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			if (graph.m_forwardOffsets[node + 1] > graph.m_forwardOffsets[node])
+			{
+				root = node;
+				break;
+			}
+		}
+		if ((root == nodesCount) || (landmarksCount == 0))
+			return false;
+
+		/// minDist[n] is the distance from the closest landmark selected to the node n.
+		std::vector<int> minDist;
+		graph.ComputeDistances(root, false, minDist);
+
+		std::vector<std::vector<int> > fromTables;
+		while (m_landmarks.size() < landmarksCount)
+		{
+			/// Select the farthest node that can be reached.
+			unsigned int farthest = nodesCount;
+			int farthestDist = 0;
+			for (unsigned int node = 0; node < nodesCount; node++)
+			{
+				if ((minDist[node] != StaticGraph::k_unreachable) && (minDist[node] > farthestDist))
+				{
+					farthestDist = minDist[node];
+					farthest = node;
+				}
+			}
+
+			/// All the reachable nodes are landmarks already.
+			if (farthest == nodesCount)
+				break;
+
+			m_landmarks.push_back(farthest);
+
+			/// The search needed by the selection is also the "from" table of this landmark.
+			fromTables.push_back(std::vector<int>());
+			graph.ComputeDistances(farthest, false, fromTables.back());
+
+			for (unsigned int node = 0; node < nodesCount; node++)
+			{
+				if (fromTables.back()[node] < minDist[node])
+					minDist[node] = fromTables.back()[node];
+			}
+		}
+
+		if (m_landmarks.empty())
+			return false;
+
+		/// The "to" tables do not depend one on each other, so run them in parallel.
+		std::vector<std::vector<int> > toTables(m_landmarks.size());
+		{
+			JobsGroup jobs(threadsPool);
+			for (size_t k = 0; k < m_landmarks.size(); k++)
+			{
+				jobs.AddJob([&graph, &toTables, this, k]()
+				{
+					graph.ComputeDistances(m_landmarks[k], true, toTables[k]);
+				});
+			}
+			jobs.Wait();
+		}
+
+		/// Store the values of each node together.
+		const size_t count = m_landmarks.size();
+		m_fromLandmark.resize(nodesCount * count);
+		m_toLandmark.resize(nodesCount * count);
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			for (size_t k = 0; k < count; k++)
+			{
+				m_fromLandmark[node * count + k] = fromTables[k][node];
+				m_toLandmark[node * count + k] = toTables[k][node];
+			}
+		}
+
+		m_nodesCount = nodesCount;
+		return true;
+	}
+
+	int Landmarks::ComputeGoalDistanceEstimate(unsigned int goalIndex, unsigned int nodeIndex) const
+	{
+		if ((goalIndex >= m_nodesCount) || (nodeIndex >= m_nodesCount))
+			return 0;
+
+		const size_t count = m_landmarks.size();
+		const int* fromGoal = &m_fromLandmark[goalIndex * count];
+		const int* fromNode = &m_fromLandmark[nodeIndex * count];
+		const int* toGoal = &m_toLandmark[goalIndex * count];
+		const int* toNode = &m_toLandmark[nodeIndex * count];
+
+		int estimate = 0;
+		for (size_t k = 0; k < count; k++)
+		{
+			/// d(L, goal) <= d(L, node) + d(node, goal)
+			if ((fromGoal[k] != StaticGraph::k_unreachable) && (fromNode[k] != StaticGraph::k_unreachable))
+			{
+				int dist = fromGoal[k] - fromNode[k];
+				if (dist > estimate)
+					estimate = dist;
+			}
+
+			/// d(node, L) <= d(node, goal) + d(goal, L)
+			if ((toNode[k] != StaticGraph::k_unreachable) && (toGoal[k] != StaticGraph::k_unreachable))
+			{
+				int dist = toNode[k] - toGoal[k];
+				if (dist > estimate)
+					estimate = dist;
+			}
+		}
+
+		return estimate;
+	}
+
+	bool Landmarks::Save(const std::string& fileName) const
+	{
+		std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		uint32_t nodesCount = m_nodesCount;
+		uint32_t landmarksCount = (uint32_t)m_landmarks.size();
+
+		file.write(k_landmarksFileMagic, sizeof(k_landmarksFileMagic));
+		file.write((const char*)&k_landmarksFileVersion, sizeof(k_landmarksFileVersion));
+		file.write((const char*)&nodesCount, sizeof(nodesCount));
+		file.write((const char*)&landmarksCount, sizeof(landmarksCount));
+
+		for (auto& landmark : m_landmarks)
+		{
+			uint32_t value = landmark;
+			file.write((const char*)&value, sizeof(value));
+		}
+
+		if (!m_fromLandmark.empty())
+		{
+			file.write((const char*)&m_fromLandmark[0], m_fromLandmark.size() * sizeof(int));
+			file.write((const char*)&m_toLandmark[0], m_toLandmark.size() * sizeof(int));
+		}
+
+		return file.good();
+	}
+
+	bool Landmarks::Load(const std::string& fileName)
+	{
+		m_nodesCount = 0;
+		m_landmarks.clear();
+		m_fromLandmark.clear();
+		m_toLandmark.clear();
+
+		std::ifstream file(fileName.c_str(), std::ios::binary);
+		if (!file)
+			return false;
+
+		char magic[sizeof(k_landmarksFileMagic)];
+		uint32_t version = 0;
+		uint32_t nodesCount = 0;
+		uint32_t landmarksCount = 0;
+
+		file.read(magic, sizeof(magic));
+		file.read((char*)&version, sizeof(version));
+		file.read((char*)&nodesCount, sizeof(nodesCount));
+		file.read((char*)&landmarksCount, sizeof(landmarksCount));
+
+		if (!file
+			|| !std::equal(magic, magic + sizeof(magic), k_landmarksFileMagic)
+			|| (version != k_landmarksFileVersion)
+			|| (landmarksCount > k_maxLandmarksCount)
+			|| (sizeof(int) != sizeof(int32_t)))
+			return false;
+
+		std::vector<unsigned int> landmarks(landmarksCount);
+		for (auto& landmark : landmarks)
+		{
+			uint32_t value = 0;
+			file.read((char*)&value, sizeof(value));
+			landmark = value;
+
+			/// The tables have no entry for this node.
+			if (landmark >= nodesCount)
+				return false;
+		}
+
+		if (!file)
+			return false;
+
+		/// Check the size of the tables before allocating them, so a broken header is not
+		/// taken for a huge file.
+		const uint64_t tablesSize = (uint64_t)nodesCount * landmarksCount * 2 * sizeof(int32_t);
+		std::streamoff position = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streamoff end = file.tellg();
+		file.seekg(position);
+		if (!file || (position < 0) || (end < position) || ((uint64_t)(end - position) < tablesSize))
+			return false;
+
+		std::vector<int> fromLandmark((size_t)nodesCount * landmarksCount);
+		std::vector<int> toLandmark((size_t)nodesCount * landmarksCount);
+		if (!fromLandmark.empty())
+		{
+			file.read((char*)&fromLandmark[0], fromLandmark.size() * sizeof(int));
+			file.read((char*)&toLandmark[0], toLandmark.size() * sizeof(int));
+		}
+
+		if (!file)
+			return false;
+
+		m_landmarks.swap(landmarks);
+		m_fromLandmark.swap(fromLandmark);
+		m_toLandmark.swap(toLandmark);
+		m_nodesCount = nodesCount;
+		return true;
+	}
+} //namespace fpe
@@ -0,0 +1,245 @@
+
+#include "ParallelSearch.h"
+
+#include "FindPathEngine/FindPathEngine.h"
+
+#include <thread>
+#include <climits>
+
+
+namespace fpe
+{
+	/** How many nodes are expanded before the partition is released for other jobs. */
+	static const unsigned int k_expandBatch = 32;
+
+	ParallelSearch::ParallelSearch(std::weak_ptr<NavMeshBase> navMesh, std::function<int(unsigned int, unsigned int)> heuristic,
+		unsigned int startIndex, unsigned int goalIndex, unsigned int jobsCount)
+		: m_navMesh(navMesh)
+		, m_heuristic(heuristic)
+		, m_startIndex(startIndex)
+		, m_goalIndex(goalIndex)
+		, m_work(0)
+		, m_bestCost(INT_MAX)
+		, m_mustStop(false)
+		, m_jobsRunning(jobsCount > 0 ? jobsCount : 1)
+		, m_nextJob(0)
+		, m_steps(0)
+	{
+		for (unsigned int i = 0; i < m_jobsRunning; i++)
+		{
+			m_partitions.push_back(std::unique_ptr<Partition>(new Partition()));
+		}
+
+		/// The start node is the first message.
+		Send(m_startIndex, m_startIndex, 0);
+	}
+
+	ParallelSearch::~ParallelSearch()
+	{
+		for (auto& partition : m_partitions)
+		{
+			Message* message = partition->m_inbox.exchange(nullptr);
+			while (message != nullptr)
+			{
+				Message* next = message->m_next;
+				delete message;
+				message = next;
+			}
+		}
+	}
+
+	unsigned int ParallelSearch::GetOwner(unsigned int node) const
+	{
+		/// Multiplicative hash, so the neighbor nodes (close indexes) go to different partitions
+		/// and all the jobs have work from the first steps.
+		return (unsigned int)(((unsigned long long)(node * 2654435761u) * m_partitions.size()) >> 32);
+	}
+
+	void ParallelSearch::Send(unsigned int node, unsigned int parent, int cost)
+	{
+		Message* message = new Message();
+		message->m_node = node;
+		message->m_parent = parent;
+		message->m_cost = cost;
+
+		/// Count the message before it can be received.
+		m_work++;
+
+		std::atomic<Message*>& inbox = m_partitions[GetOwner(node)]->m_inbox;
+		message->m_next = inbox.load();
+		while (!inbox.compare_exchange_weak(message->m_next, message))
+		{
+			/// Another job pushed meanwhile, m_next was updated, try again.
+		}
+	}
+
+	void ParallelSearch::Relax(Partition& partition, unsigned int node, unsigned int parent, int cost)
+	{
+		auto it = partition.m_nodes.find(node);
+		if (it == partition.m_nodes.end())
+		{
+			NodeRecord record;
+			record.m_parent = parent;
+			record.m_cost = cost;
+			record.m_distToTarget = (node == m_goalIndex) ? 0 : m_heuristic(m_goalIndex, node);
+			it = partition.m_nodes.insert(std::make_pair(node, record)).first;
+		}
+		else if (cost < it->second.m_cost)
+		{
+			it->second.m_parent = parent;
+			it->second.m_cost = cost;
+		}
+		else
+		{
+			return;
+		}
+
+		if (node == m_goalIndex)
+		{
+			/// A better path to goal. The goal is not expanded.
+			int best = m_bestCost;
+			while ((cost < best) && !m_bestCost.compare_exchange_weak(best, cost))
+			{
+			}
+			return;
+		}
+
+		partition.m_openList.push(OpenEntry(cost + it->second.m_distToTarget, std::make_pair(cost, node)));
+	}
+
+	bool ParallelSearch::HasUsefulWork(Partition& partition)
+	{
+		while (!partition.m_openList.empty())
+		{
+			const OpenEntry& top = partition.m_openList.top();
+
+			/// Skip the entries that were improved after they were pushed.
+			if (top.second.first > partition.m_nodes[top.second.second].m_cost)
+			{
+				partition.m_openList.pop();
+				continue;
+			}
+
+			return top.first < m_bestCost;
+		}
+
+		return false;
+	}
+
+	bool ParallelSearch::ProcessPartition(Partition& partition, NavMeshBase* navMesh)
+	{
+		/// Take all the messages at once.
+		long long received = 0;
+		Message* message = partition.m_inbox.exchange(nullptr);
+		while (message != nullptr)
+		{
+			Relax(partition, message->m_node, message->m_parent, message->m_cost);
+
+			Message* next = message->m_next;
+			delete message;
+			message = next;
+			received++;
+		}
+
+		/// The partition must be counted before the messages are uncounted,
+		/// otherwise m_work can reach 0 while there is still work to do.
+		bool useful = HasUsefulWork(partition);
+		if (useful && !partition.m_active)
+		{
+			partition.m_active = true;
+			m_work++;
+		}
+		if (received > 0)
+			m_work -= received;
+
+		unsigned int expanded = 0;
+		while (useful && (expanded < k_expandBatch))
+		{
+			OpenEntry entry = partition.m_openList.top();
+			partition.m_openList.pop();
+
+			unsigned int node = entry.second.second;
+			int cost = entry.second.first;
+
+			for (auto& neighbor : navMesh->GetNeighbors(node))
+			{
+				int neighborCost = cost + navMesh->ComputeCost(node, neighbor);
+				if (neighborCost >= m_bestCost)
+					continue;
+
+				if (&partition == m_partitions[GetOwner(neighbor)].get())
+					Relax(partition, neighbor, node, neighborCost);
+				else
+					Send(neighbor, node, neighborCost);
+			}
+
+			expanded++;
+			useful = HasUsefulWork(partition);
+		}
+		m_steps += expanded;
+
+		if (!useful && partition.m_active)
+		{
+			partition.m_active = false;
+			m_work--;
+		}
+
+		return (received > 0) || (expanded > 0);
+	}
+
+	bool ParallelSearch::Run(const std::atomic<bool>* mustStop)
+	{
+		auto navMesh = m_navMesh.lock();
+		if (navMesh == nullptr)
+			m_mustStop = true;
+
+		const unsigned int partitionsCount = (unsigned int)m_partitions.size();
+		const unsigned int first = m_nextJob++ % partitionsCount;
+
+		while ((m_work > 0) && !m_mustStop)
+		{
+			if ((mustStop != nullptr) && *mustStop)
+			{
+				m_mustStop = true;
+				break;
+			}
+
+			/// Start with the own partition, then help the others that are not locked.
+			bool worked = false;
+			for (unsigned int i = 0; i < partitionsCount; i++)
+			{
+				Partition& partition = *m_partitions[(first + i) % partitionsCount];
+				if (!partition.m_mutex.try_lock())
+					continue;
+
+				worked |= ProcessPartition(partition, navMesh.get());
+				partition.m_mutex.unlock();
+			}
+
+			if (!worked)
+				std::this_thread::yield();
+		}
+
+		return (--m_jobsRunning == 0);
+	}
+
+	bool ParallelSearch::GetPath(std::vector<unsigned int>& path) const
+	{
+		path.clear();
+		if (m_mustStop || (m_bestCost == INT_MAX))
+			return false;
+
+		/// Follow the parents from goal to start. Each node is in the partition that owns it.
+		unsigned int node = m_goalIndex;
+		while (true)
+		{
+			path.push_back(node);
+			if (node == m_startIndex)
+				break;
+
+			node = m_partitions[GetOwner(node)]->m_nodes.at(node).m_parent;
+		}
+
+		return true;
+	}
+} //namespace fpe
@@ -0,0 +1,151 @@
+#ifndef PARALLELSEARCH_H
+#define PARALLELSEARCH_H
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+
+namespace fpe
+{
+	/** Forward declaration. */
+	class NavMeshBase;
+
+	/** This is the search used by the tickets that run in parallel (HDA*, Hash Distributed A*).
+	* The nodes are distributed to partitions by a hash of their index. Each partition have its own
+	* open list and its own nodes, and when a node of another partition is reached, a message is
+	* sent to that partition on a lock free list. Run() is called by many jobs of the threads pool;
+	* each job processes the partitions that are not locked by other jobs, so the search finishes
+	* even if only one job gets a thread.
+	* The search is finished when there is no message in flight and no partition has a node with
+	* "F" smaller than the best cost found to the goal. m_work counts both of them.*/
+	class ParallelSearch
+	{
+	public:
+
+		/** The constructor.
+		* @param navMesh is the user's navmesh.
+		* @param heuristic is the function used to estimate the distance (goalIndex, nodeIndex) -> distance.
+		* @param startIndex is the start node.
+		* @param goalIndex is the target node.
+		* @param jobsCount is the number of jobs that will call Run(). A partition is created for each job.*/
+		ParallelSearch(std::weak_ptr<NavMeshBase> navMesh, std::function<int(unsigned int, unsigned int)> heuristic,
+			unsigned int startIndex, unsigned int goalIndex, unsigned int jobsCount);
+
+		/** The destructor deletes the messages that were not received.*/
+		~ParallelSearch();
+
+		/** This is the job for the threads pool. Returns when the search is finished or stopped.
+		* @param mustStop is checked regularly. If it becomes true the search is stopped. Can be null.
+		* @return true for the last job that returns. Only then the results can be read.*/
+		bool Run(const std::atomic<bool>* mustStop);
+
+		/** Stop the search. The jobs will return as soon as possible.*/
+		void Stop() { m_mustStop = true; }
+
+		/** Getter for the stop flag. */
+		bool IsStopped() const { return m_mustStop; }
+
+		/** Get the path found.
+		* @param path is filled with the nodes of the path, from goal to start (like Ticket::GetFoundPath()).
+		* @return false if there is no path.*/
+		bool GetPath(std::vector<unsigned int>& path) const;
+
+		/** Getter for the number of nodes expanded by all the jobs */
+		int GetSteps() const { return m_steps; }
+
+	private:
+
+		/** This is sent to the partition that owns the node. */
+		struct Message
+		{
+			unsigned int m_node;
+			unsigned int m_parent;
+			int m_cost;
+			Message* m_next;
+		};
+
+		/** What is known about a node */
+		struct NodeRecord
+		{
+			unsigned int m_parent;
+
+			/** "G" */
+			int m_cost;
+
+			/** "H" */
+			int m_distToTarget;
+		};
+
+		/** Is the open list entry: ("F", "G", node). The smallest "F" is on top. */
+		typedef std::pair<int, std::pair<int, unsigned int> > OpenEntry;
+
+		struct Partition
+		{
+			Partition() : m_inbox(nullptr), m_active(false) {}
+
+			/** Is locked by the job that processes the partition */
+			std::mutex m_mutex;
+
+			/** The messages received. Is a lock free stack: the senders push, the owner takes all. */
+			std::atomic<Message*> m_inbox;
+
+			std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry> > m_openList;
+
+			std::unordered_map<unsigned int, NodeRecord> m_nodes;
+
+			/** Is true if this partition is counted in m_work. */
+			bool m_active;
+		};
+
+		/** Get the partition that owns the node. */
+		unsigned int GetOwner(unsigned int node) const;
+
+		/** Take the messages and expand a few nodes. The partition must be locked.
+		* @return false if there was nothing to do.*/
+		bool ProcessPartition(Partition& partition, NavMeshBase* navMesh);
+
+		/** Update the node if the cost is better. The partition must be locked.*/
+		void Relax(Partition& partition, unsigned int node, unsigned int parent, int cost);
+
+		/** Send the node to the partition that owns it.*/
+		void Send(unsigned int node, unsigned int parent, int cost);
+
+		/** Remove the old entries from the top of open list.
+		* @return true if the top node can still improve the path.*/
+		bool HasUsefulWork(Partition& partition);
+
+		std::weak_ptr<NavMeshBase> m_navMesh;
+
+		std::function<int(unsigned int, unsigned int)> m_heuristic;
+
+		unsigned int m_startIndex;
+
+		unsigned int m_goalIndex;
+
+		std::vector<std::unique_ptr<Partition> > m_partitions;
+
+		/** The messages in flight plus the active partitions. The search is finished when is 0.*/
+		std::atomic<long long> m_work;
+
+		/** The best cost found to the goal */
+		std::atomic<int> m_bestCost;
+
+		std::atomic<bool> m_mustStop;
+
+		/** How many jobs did not return from Run() */
+		std::atomic<unsigned int> m_jobsRunning;
+
+		/** Each job starts with another partition */
+		std::atomic<unsigned int> m_nextJob;
+
+		std::atomic<int> m_steps;
+	};
+
+} // namespace fpe
+
+#endif //PARALLELSEARCH_H
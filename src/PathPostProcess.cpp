@@ -0,0 +1,131 @@
+
+#include "FindPathEngine/PathPostProcess.h"
+#include "FindPathEngine/FindPathEngine.h"
+
+#include "VarintCoding.h"
+
+
+namespace fpe
+{
+	/** The middle node is removed if the angle between the two segments is smaller than this (as sin^2 of the angle) */
+	static const float k_collinearTolerance = 1e-6f;
+
+	/** Return true if b is on the segment from a to c, and the direction is kept.*/
+	static bool IsCollinear(const std::array<float, 3>& a, const std::array<float, 3>& b, const std::array<float, 3>& c)
+	{
+		float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float v[3] = { c[0] - b[0], c[1] - b[1], c[2] - b[2] };
+
+		float cross[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+		float crossLength = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+		float uLength = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+		float vLength = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		float dot = u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+
+		/// If the path goes back, the middle node is where it turns.
+		return (dot >= 0) && (crossLength <= k_collinearTolerance * uLength * vLength);
+	}
+
+	void PathPostProcess::BuildWaypoints(NavMeshBase* navMesh, const std::vector<unsigned int>& path, bool stringPulling, bool removeCollinear, std::vector<unsigned int>& waypoints)
+	{
+		waypoints.clear();
+		waypoints.reserve(path.size());
+
+		/// The path is goal -> start, the waypoints are start -> goal.
+		if (!removeCollinear || (navMesh == nullptr))
+		{
+			waypoints.assign(path.rbegin(), path.rend());
+		}
+		else
+		{
+			/// The positions of the waypoints kept, so each position is asked only once.
+			std::vector<std::array<float, 3> > positions;
+			std::vector<bool> known;
+			positions.reserve(path.size());
+			known.reserve(path.size());
+
+			for (auto it = path.rbegin(); it != path.rend(); ++it)
+			{
+				std::array<float, 3> position;
+				bool positionKnown = navMesh->GetNodePosition(*it, position);
+
+				while (positionKnown && (waypoints.size() >= 2)
+					&& known[known.size() - 1] && known[known.size() - 2]
+					&& IsCollinear(positions[positions.size() - 2], positions.back(), position))
+				{
+					waypoints.pop_back();
+					positions.pop_back();
+					known.pop_back();
+				}
+
+				waypoints.push_back(*it);
+				positions.push_back(position);
+				known.push_back(positionKnown);
+			}
+		}
+
+		/// The nodes on a straight line are removed first, so the line of sight
+		/// is checked only between the corners of the path.
+		if (!stringPulling || (navMesh == nullptr) || (waypoints.size() < 3))
+			return;
+
+		/// Keep the last node from where the anchor can be seen, and move the anchor there.
+		size_t count = 1;
+		size_t anchor = 0;
+		for (size_t i = 2; i < waypoints.size(); i++)
+		{
+			if (!navMesh->HasLineOfSight(waypoints[anchor], waypoints[i]))
+			{
+				anchor = i - 1;
+				waypoints[count++] = waypoints[anchor];
+			}
+		}
+		waypoints[count++] = waypoints.back();
+		waypoints.resize(count);
+	}
+
+	void PathPostProcess::EncodeWaypoints(const std::vector<unsigned int>& waypoints, std::vector<unsigned char>& data)
+	{
+		data.clear();
+		WriteVarint(data, waypoints.size());
+
+		int64_t previous = 0;
+		for (auto& waypoint : waypoints)
+		{
+			WriteVarint(data, ZigZagEncode((int64_t)waypoint - previous));
+			previous = waypoint;
+		}
+	}
+
+	bool PathPostProcess::DecodeWaypoints(const std::vector<unsigned char>& data, std::vector<unsigned int>& waypoints)
+	{
+		waypoints.clear();
+		if (data.empty())
+			return false;
+
+		const unsigned char* position = &data[0];
+		const unsigned char* end = position + data.size();
+
+		uint64_t count = 0;
+		if (!ReadVarint(position, end, count) || (count > data.size()))
+			return false;
+
+		waypoints.reserve((size_t)count);
+
+		int64_t previous = 0;
+		for (uint64_t i = 0; i < count; i++)
+		{
+			uint64_t delta = 0;
+			if (!ReadVarint(position, end, delta))
+			{
+				waypoints.clear();
+				return false;
+			}
+
+			previous += ZigZagDecode(delta);
+			waypoints.push_back((unsigned int)previous);
+		}
+
+		return true;
+	}
+} //namespace fpe
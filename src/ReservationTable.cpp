@@ -0,0 +1,251 @@
+
+#include "FindPathEngine/ReservationTable.h"
+
+#include <algorithm>
+
+
+namespace fpe
+{
+	const unsigned int ReservationTable::k_noAgent;
+
+	ReservationTable::ReservationTable(unsigned int shardsCount)
+	{
+		if (shardsCount == 0)
+			shardsCount = 1;
+
+		for (unsigned int i = 0; i < shardsCount; i++)
+		{
+			m_shards.push_back(std::unique_ptr<Shard>(new Shard()));
+		}
+	}
+
+	ReservationTable::Shard& ReservationTable::GetShard(uint64_t key)
+	{
+		/// Mix the node and the time, so a path is spread on many shards.
+		uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+		return *m_shards[(size_t)((hash >> 32) % m_shards.size())];
+	}
+
+	unsigned int ReservationTable::GetOwner(unsigned int nodeIndex, unsigned int time)
+	{
+		uint64_t key = GetKey(nodeIndex, time);
+		Shard& shard = GetShard(key);
+
+		std::lock_guard<std::mutex> lock(shard.m_mutex);
+		auto it = shard.m_owners.find(key);
+		return (it != shard.m_owners.end()) ? it->second : k_noAgent;
+	}
+
+	bool ReservationTable::IsFree(unsigned int agentId, unsigned int nodeIndex, unsigned int time)
+	{
+		unsigned int owner = GetOwner(nodeIndex, time);
+		return (owner == k_noAgent) || (owner == agentId);
+	}
+
+	bool ReservationTable::Reserve(unsigned int agentId, unsigned int nodeIndex, unsigned int time)
+	{
+		uint64_t key = GetKey(nodeIndex, time);
+
+		/// Claim the key. Only one of the agents that try at the same time will succeed.
+		{
+			Shard& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+			auto result = shard.m_owners.insert(std::make_pair(key, agentId));
+
+			/// The key was already reserved. Is fine only if this agent reserved it.
+			if (!result.second)
+				return (result.first->second == agentId);
+		}
+
+		/// Remember the key, so Release() can find it.
+		{
+			Shard& agentShard = *m_shards[agentId % m_shards.size()];
+			std::lock_guard<std::mutex> lock(agentShard.m_mutex);
+			agentShard.m_agents[agentId].push_back(key);
+		}
+
+		return true;
+	}
+
+	bool ReservationTable::ReservePath(unsigned int agentId, const std::vector<unsigned int>& path, unsigned int startTime)
+	{
+		std::vector<uint64_t> claimed;
+
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			unsigned int time = startTime + (unsigned int)i;
+			uint64_t key = GetKey(path[i], time);
+
+			unsigned int owner = GetOwner(path[i], time);
+			if (owner == agentId)
+				continue;
+
+			if (!Reserve(agentId, path[i], time))
+			{
+				/// Another agent was faster. Undo this call.
+				for (auto& claimedKey : claimed)
+				{
+					Unreserve(agentId, claimedKey);
+				}
+				return false;
+			}
+
+			claimed.push_back(key);
+		}
+
+		/// Two agents that reserve at the same time can still swap their nodes. Check this after
+		/// all the nodes are claimed: of two such agents, at least the last one will see the other.
+		for (size_t i = 1; i < path.size(); i++)
+		{
+			if (path[i] == path[i - 1])
+				continue;
+
+			unsigned int time = startTime + (unsigned int)i - 1;
+			unsigned int other = GetOwner(path[i], time);
+			if ((other != k_noAgent) && (other != agentId) && (GetOwner(path[i - 1], time + 1) == other))
+			{
+				for (auto& claimedKey : claimed)
+				{
+					Unreserve(agentId, claimedKey);
+				}
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ReservationTable::ReplacePath(unsigned int agentId, const std::vector<unsigned int>& path, unsigned int startTime)
+	{
+		if (!ReservePath(agentId, path, startTime))
+			return false;
+
+		std::vector<uint64_t> pathKeys;
+		pathKeys.reserve(path.size());
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			pathKeys.push_back(GetKey(path[i], startTime + (unsigned int)i));
+		}
+		std::sort(pathKeys.begin(), pathKeys.end());
+
+		/// Take the keys that are not on the new path, then release them.
+		std::vector<uint64_t> oldKeys;
+		{
+			Shard& agentShard = *m_shards[agentId % m_shards.size()];
+			std::lock_guard<std::mutex> lock(agentShard.m_mutex);
+
+			std::vector<uint64_t>& keys = agentShard.m_agents[agentId];
+			for (size_t i = 0; i < keys.size();)
+			{
+				if (std::binary_search(pathKeys.begin(), pathKeys.end(), keys[i]))
+				{
+					i++;
+					continue;
+				}
+
+				oldKeys.push_back(keys[i]);
+				keys[i] = keys.back();
+				keys.pop_back();
+			}
+		}
+
+		for (auto& key : oldKeys)
+		{
+			Shard& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+			auto it = shard.m_owners.find(key);
+			if ((it != shard.m_owners.end()) && (it->second == agentId))
+				shard.m_owners.erase(it);
+		}
+
+		return true;
+	}
+
+	void ReservationTable::Unreserve(unsigned int agentId, uint64_t key)
+	{
+		{
+			Shard& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+			auto it = shard.m_owners.find(key);
+			if ((it == shard.m_owners.end()) || (it->second != agentId))
+				return;
+			shard.m_owners.erase(it);
+		}
+
+		{
+			Shard& agentShard = *m_shards[agentId % m_shards.size()];
+			std::lock_guard<std::mutex> lock(agentShard.m_mutex);
+
+			std::vector<uint64_t>& keys = agentShard.m_agents[agentId];
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				if (keys[i] == key)
+				{
+					keys[i] = keys.back();
+					keys.pop_back();
+					break;
+				}
+			}
+		}
+	}
+
+	void ReservationTable::Release(unsigned int agentId)
+	{
+		/// Take the list of keys, then release them. The shards are never locked two at a time.
+		std::vector<uint64_t> keys;
+		{
+			Shard& agentShard = *m_shards[agentId % m_shards.size()];
+			std::lock_guard<std::mutex> lock(agentShard.m_mutex);
+
+			auto it = agentShard.m_agents.find(agentId);
+			if (it == agentShard.m_agents.end())
+				return;
+
+			keys.swap(it->second);
+			agentShard.m_agents.erase(it);
+		}
+
+		for (auto& key : keys)
+		{
+			Shard& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+			auto it = shard.m_owners.find(key);
+			if ((it != shard.m_owners.end()) && (it->second == agentId))
+				shard.m_owners.erase(it);
+		}
+	}
+
+	void ReservationTable::ReleaseBefore(unsigned int time)
+	{
+		const uint64_t limit = GetKey(0, time);
+
+		for (auto& shard : m_shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->m_mutex);
+
+			for (auto it = shard->m_owners.begin(); it != shard->m_owners.end();)
+			{
+				if (it->first < limit)
+					it = shard->m_owners.erase(it);
+				else
+					++it;
+			}
+
+			for (auto it = shard->m_agents.begin(); it != shard->m_agents.end();)
+			{
+				std::vector<uint64_t>& keys = it->second;
+				keys.erase(std::remove_if(keys.begin(), keys.end(),
+					[limit](uint64_t key) { return key < limit; }), keys.end());
+
+				if (keys.empty())
+					it = shard->m_agents.erase(it);
+				else
+					++it;
+			}
+		}
+	}
+} //namespace fpe
@@ -0,0 +1,114 @@
+
+#include "FindPathEngine/StaticGraph.h"
+#include "FindPathEngine/FindPathEngine.h"
+
+#include <queue>
+#include <functional>
+
+
+namespace fpe
+{
+	const int StaticGraph::k_unreachable;
+
+	StaticGraph::StaticGraph()
+		: m_nodesCount(0)
+	{
+	}
+
+	bool StaticGraph::Build(std::weak_ptr<NavMeshBase> weakNavMesh, unsigned int nodesCount)
+	{
+		auto navMesh = weakNavMesh.lock();
+		if (navMesh == nullptr)
+			return false;
+
+		m_nodesCount = nodesCount;
+
+		m_forwardOffsets.assign(nodesCount + 1, 0);
+		m_forwardTargets.clear();
+		m_forwardCosts.clear();
+
+		/// Ask the navmesh for every edge, only once.
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			m_forwardOffsets[node] = (unsigned int)m_forwardTargets.size();
+
+			for (auto& neighbor : navMesh->GetNeighbors(node))
+			{
+				if (neighbor >= nodesCount)
+				{
+					m_nodesCount = 0;
+					return false;
+				}
+
+				m_forwardTargets.push_back(neighbor);
+				m_forwardCosts.push_back(navMesh->ComputeCost(node, neighbor));
+			}
+		}
+		m_forwardOffsets[nodesCount] = (unsigned int)m_forwardTargets.size();
+
+		/// Build the reversed edges. First count the incoming edges for each node...
+		m_backwardOffsets.assign(nodesCount + 1, 0);
+		for (auto& target : m_forwardTargets)
+		{
+			m_backwardOffsets[target + 1]++;
+		}
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			m_backwardOffsets[node + 1] += m_backwardOffsets[node];
+		}
+
+		/// ... and then place them.
+		m_backwardTargets.resize(m_forwardTargets.size());
+		m_backwardCosts.resize(m_forwardCosts.size());
+		std::vector<unsigned int> fill(m_backwardOffsets.begin(), m_backwardOffsets.end() - 1);
+		for (unsigned int node = 0; node < nodesCount; node++)
+		{
+			for (unsigned int e = m_forwardOffsets[node]; e < m_forwardOffsets[node + 1]; e++)
+			{
+				unsigned int pos = fill[m_forwardTargets[e]]++;
+				m_backwardTargets[pos] = node;
+				m_backwardCosts[pos] = m_forwardCosts[e];
+			}
+		}
+
+		return true;
+	}
+
+	void StaticGraph::ComputeDistances(unsigned int source, bool backward, std::vector<int>& distances) const
+	{
+		distances.assign(m_nodesCount, k_unreachable);
+		if (source >= m_nodesCount)
+			return;
+
+		const std::vector<unsigned int>& offsets = backward ? m_backwardOffsets : m_forwardOffsets;
+		const std::vector<unsigned int>& targets = backward ? m_backwardTargets : m_forwardTargets;
+		const std::vector<int>& costs = backward ? m_backwardCosts : m_forwardCosts;
+
+		/// The pair is (distance, node). The smallest distance is on top.
+		typedef std::pair<int, unsigned int> Entry;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+
+		distances[source] = 0;
+		open.push(Entry(0, source));
+
+		while (!open.empty())
+		{
+			Entry entry = open.top();
+			open.pop();
+
+			/// Skip the entries that were improved after they were pushed.
+			if (entry.first > distances[entry.second])
+				continue;
+
+			for (unsigned int e = offsets[entry.second]; e < offsets[entry.second + 1]; e++)
+			{
+				int dist = entry.first + costs[e];
+				if (dist < distances[targets[e]])
+				{
+					distances[targets[e]] = dist;
+					open.push(Entry(dist, targets[e]));
+				}
+			}
+		}
+	}
+} //namespace fpe
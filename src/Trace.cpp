@@ -0,0 +1,327 @@
+
+#include "FindPathEngine/Trace.h"
+
+#include "VarintCoding.h"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+
+namespace fpe
+{
+	/** The first bytes of the file written by Trace::Save */
+	static const char k_traceFileMagic[4] = { 'F', 'P', 'E', 'T' };
+
+	/** Increment this when the file layout is changed. The version 1 have no
+	* post process answers and no ticket settings, and can still be read.*/
+	static const unsigned char k_traceFileVersion = 2;
+
+	/** The flags of a ticket record */
+	static const unsigned char k_ticketFlagAsync = 1;
+	static const unsigned char k_ticketFlagParallel = 2;
+	static const unsigned char k_ticketFlagCooperative = 4;
+	static const unsigned char k_ticketFlagPostProcess = 8;
+	static const unsigned char k_ticketFlagStringPulling = 16;
+	static const unsigned char k_ticketFlagRemoveCollinear = 32;
+	static const unsigned char k_ticketFlagEncodeWaypoints = 64;
+
+	/** Get the keys of the map, sorted, so the deltas between them are small.*/
+	template <typename Map>
+	static std::vector<typename Map::key_type> GetSortedKeys(const Map& map)
+	{
+		std::vector<typename Map::key_type> keys;
+		keys.reserve(map.size());
+		for (auto& entry : map)
+		{
+			keys.push_back(entry.first);
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	/** Write the pairs map: the first node as delta from the previous one, the second node as delta
+	* from the previous one if the first is the same, otherwise as delta from the first node.*/
+	static void WritePairs(std::vector<unsigned char>& buffer, const std::unordered_map<uint64_t, int>& pairs)
+	{
+		WriteVarint(buffer, pairs.size());
+
+		int64_t previousFirst = 0;
+		int64_t previousSecond = 0;
+		for (auto& key : GetSortedKeys(pairs))
+		{
+			int64_t first = (int64_t)(key >> 32);
+			int64_t second = (int64_t)(key & 0xFFFFFFFF);
+			if (first != previousFirst)
+				previousSecond = first;
+
+			WriteVarint(buffer, (uint64_t)(first - previousFirst));
+			WriteVarint(buffer, ZigZagEncode(second - previousSecond));
+			WriteVarint(buffer, ZigZagEncode(pairs.at(key)));
+
+			previousFirst = first;
+			previousSecond = second;
+		}
+	}
+
+	static bool ReadPairs(const unsigned char*& position, const unsigned char* end, std::unordered_map<uint64_t, int>& pairs)
+	{
+		uint64_t count = 0;
+		if (!ReadVarint(position, end, count))
+			return false;
+
+		int64_t previousFirst = 0;
+		int64_t previousSecond = 0;
+		for (uint64_t i = 0; i < count; i++)
+		{
+			uint64_t firstDelta, secondDelta, value;
+			if (!ReadVarint(position, end, firstDelta) || !ReadVarint(position, end, secondDelta) || !ReadVarint(position, end, value))
+				return false;
+
+			int64_t first = previousFirst + (int64_t)firstDelta;
+			if (first != previousFirst)
+				previousSecond = first;
+			int64_t second = previousSecond + ZigZagDecode(secondDelta);
+
+			pairs[((uint64_t)first << 32) | (uint64_t)(second & 0xFFFFFFFF)] = (int)ZigZagDecode(value);
+
+			previousFirst = first;
+			previousSecond = second;
+		}
+
+		return true;
+	}
+
+	/** The floats are written with their 4 bytes, low byte first.*/
+	static void WriteFloat(std::vector<unsigned char>& buffer, float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			buffer.push_back((unsigned char)(bits >> (8 * i)));
+		}
+	}
+
+	static bool ReadFloat(const unsigned char*& position, const unsigned char* end, float& value)
+	{
+		if (end - position < 4)
+			return false;
+
+		uint32_t bits = 0;
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			bits |= (uint32_t)(*position++) << (8 * i);
+		}
+		memcpy(&value, &bits, sizeof(value));
+		return true;
+	}
+
+	bool Trace::Save(const std::string& fileName) const
+	{
+		std::vector<unsigned char> buffer(k_traceFileMagic, k_traceFileMagic + sizeof(k_traceFileMagic));
+		buffer.push_back(k_traceFileVersion);
+
+		/// The neighbors: node delta, count, and each neighbor as delta from the node.
+		WriteVarint(buffer, m_neighbors.size());
+		unsigned int previousNode = 0;
+		for (auto& node : GetSortedKeys(m_neighbors))
+		{
+			const std::vector<unsigned int>& neighbors = m_neighbors.at(node);
+
+			WriteVarint(buffer, node - previousNode);
+			WriteVarint(buffer, neighbors.size());
+			for (auto& neighbor : neighbors)
+			{
+				WriteVarint(buffer, ZigZagEncode((int64_t)neighbor - (int64_t)node));
+			}
+			previousNode = node;
+		}
+
+		WritePairs(buffer, m_costs);
+		WritePairs(buffer, m_estimates);
+		WritePairs(buffer, m_linesOfSight);
+
+		/// The positions: node delta, known, and the 3 coordinates if known.
+		WriteVarint(buffer, m_positions.size());
+		previousNode = 0;
+		for (auto& node : GetSortedKeys(m_positions))
+		{
+			const PositionRecord& position = m_positions.at(node);
+
+			WriteVarint(buffer, node - previousNode);
+			buffer.push_back(position.m_known ? 1 : 0);
+			if (position.m_known)
+			{
+				for (auto& coordinate : position.m_position)
+				{
+					WriteFloat(buffer, coordinate);
+				}
+			}
+			previousNode = node;
+		}
+
+		/// The tickets: time delta, start, goal as delta from start, flags, and the cooperative settings.
+		WriteVarint(buffer, m_tickets.size());
+		uint64_t previousTime = 0;
+		for (auto& ticket : m_tickets)
+		{
+			unsigned char flags = (ticket.m_runAsync ? k_ticketFlagAsync : 0) | (ticket.m_runParallel ? k_ticketFlagParallel : 0)
+				| (ticket.m_cooperative ? k_ticketFlagCooperative : 0) | (ticket.m_postProcess ? k_ticketFlagPostProcess : 0)
+				| (ticket.m_stringPulling ? k_ticketFlagStringPulling : 0) | (ticket.m_removeCollinear ? k_ticketFlagRemoveCollinear : 0)
+				| (ticket.m_encodeWaypoints ? k_ticketFlagEncodeWaypoints : 0);
+
+			WriteVarint(buffer, ticket.m_time - previousTime);
+			WriteVarint(buffer, ticket.m_startIndex);
+			WriteVarint(buffer, ZigZagEncode((int64_t)ticket.m_goalIndex - (int64_t)ticket.m_startIndex));
+			buffer.push_back(flags);
+			if (ticket.m_cooperative)
+			{
+				WriteVarint(buffer, ticket.m_agentId);
+				WriteVarint(buffer, ticket.m_startTime);
+				WriteVarint(buffer, ticket.m_window);
+				WriteVarint(buffer, ZigZagEncode(ticket.m_waitCost));
+			}
+			previousTime = ticket.m_time;
+		}
+
+		std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write((const char*)&buffer[0], buffer.size());
+		return file.good();
+	}
+
+	bool Trace::Load(const std::string& fileName)
+	{
+		Clear();
+
+		std::ifstream file(fileName.c_str(), std::ios::binary);
+		if (!file)
+			return false;
+
+		std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if ((buffer.size() < sizeof(k_traceFileMagic) + 1)
+			|| !std::equal(k_traceFileMagic, k_traceFileMagic + sizeof(k_traceFileMagic), buffer.begin())
+			|| (buffer[sizeof(k_traceFileMagic)] < 1) || (buffer[sizeof(k_traceFileMagic)] > k_traceFileVersion))
+			return false;
+
+		const unsigned char version = buffer[sizeof(k_traceFileMagic)];
+
+		const unsigned char* position = &buffer[0] + sizeof(k_traceFileMagic) + 1;
+		const unsigned char* end = &buffer[0] + buffer.size();
+
+		bool valid = true;
+
+		uint64_t count = 0;
+		valid = valid && ReadVarint(position, end, count);
+		uint64_t node = 0;
+		for (uint64_t i = 0; valid && (i < count); i++)
+		{
+			uint64_t delta, neighborsCount;
+			valid = ReadVarint(position, end, delta) && ReadVarint(position, end, neighborsCount);
+			node += delta;
+
+			std::vector<unsigned int>& neighbors = m_neighbors[(unsigned int)node];
+			for (uint64_t j = 0; valid && (j < neighborsCount); j++)
+			{
+				uint64_t neighbor;
+				valid = ReadVarint(position, end, neighbor);
+				neighbors.push_back((unsigned int)((int64_t)node + ZigZagDecode(neighbor)));
+			}
+		}
+
+		valid = valid && ReadPairs(position, end, m_costs);
+		valid = valid && ReadPairs(position, end, m_estimates);
+
+		if (version >= 2)
+		{
+			valid = valid && ReadPairs(position, end, m_linesOfSight);
+
+			valid = valid && ReadVarint(position, end, count);
+			node = 0;
+			for (uint64_t i = 0; valid && (i < count); i++)
+			{
+				uint64_t delta;
+				valid = ReadVarint(position, end, delta) && (position < end);
+				if (!valid)
+					break;
+				node += delta;
+
+				PositionRecord& record = m_positions[(unsigned int)node];
+				record.m_known = (*position++ != 0);
+				record.m_position.fill(0);
+				for (unsigned int j = 0; valid && record.m_known && (j < 3); j++)
+				{
+					valid = ReadFloat(position, end, record.m_position[j]);
+				}
+			}
+		}
+
+		valid = valid && ReadVarint(position, end, count);
+		uint64_t time = 0;
+		for (uint64_t i = 0; valid && (i < count); i++)
+		{
+			uint64_t delta, start, goal;
+			valid = ReadVarint(position, end, delta) && ReadVarint(position, end, start)
+				&& ReadVarint(position, end, goal) && (position < end);
+			if (!valid)
+				break;
+
+			unsigned char flags = *position++;
+			time += delta;
+
+			TicketRecord ticket;
+			ticket.m_time = time;
+			ticket.m_startIndex = (unsigned int)start;
+			ticket.m_goalIndex = (unsigned int)((int64_t)start + ZigZagDecode(goal));
+			ticket.m_runAsync = (flags & k_ticketFlagAsync) != 0;
+			ticket.m_runParallel = (flags & k_ticketFlagParallel) != 0;
+			ticket.m_cooperative = (flags & k_ticketFlagCooperative) != 0;
+			ticket.m_agentId = 0;
+			ticket.m_startTime = 0;
+			ticket.m_window = 0;
+			ticket.m_waitCost = 0;
+			ticket.m_postProcess = (flags & k_ticketFlagPostProcess) != 0;
+			ticket.m_stringPulling = (flags & k_ticketFlagStringPulling) != 0;
+			ticket.m_removeCollinear = (flags & k_ticketFlagRemoveCollinear) != 0;
+			ticket.m_encodeWaypoints = (flags & k_ticketFlagEncodeWaypoints) != 0;
+
+			if (ticket.m_cooperative)
+			{
+				uint64_t agentId, startTime, window, waitCost;
+				valid = ReadVarint(position, end, agentId) && ReadVarint(position, end, startTime)
+					&& ReadVarint(position, end, window) && ReadVarint(position, end, waitCost);
+				if (!valid)
+					break;
+
+				ticket.m_agentId = (unsigned int)agentId;
+				ticket.m_startTime = (unsigned int)startTime;
+				ticket.m_window = (unsigned int)window;
+				ticket.m_waitCost = (int)ZigZagDecode(waitCost);
+			}
+
+			m_tickets.push_back(ticket);
+		}
+
+		if (!valid)
+		{
+			Clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Trace::Clear()
+	{
+		m_neighbors.clear();
+		m_costs.clear();
+		m_estimates.clear();
+		m_linesOfSight.clear();
+		m_positions.clear();
+		m_tickets.clear();
+	}
+} //namespace fpe
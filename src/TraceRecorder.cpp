@@ -0,0 +1,201 @@
+
+#include "FindPathEngine/TraceRecorder.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+
+namespace fpe
+{
+	/** Used to give an unique id to each recorder */
+	static std::atomic<uint64_t> s_recordersCount(0);
+
+	TraceRecorder::TraceRecorder(std::weak_ptr<NavMeshBase> navMesh)
+		: m_navMesh(navMesh)
+		, m_startTime(std::chrono::steady_clock::now())
+		, m_id(++s_recordersCount)
+		, m_ticketsCount(0)
+	{
+	}
+
+	std::shared_ptr<TraceRecorder::ThreadBuffer> TraceRecorder::GetThreadBuffer()
+	{
+		/// Each thread remembers its buffer of each recorder. The recorders are found by id, not by
+		/// address, because a new recorder can have the address of a destroied one.
+		thread_local std::unordered_map<uint64_t, std::weak_ptr<ThreadBuffer> > threadBuffers;
+
+		auto it = threadBuffers.find(m_id);
+		if (it != threadBuffers.end())
+		{
+			std::shared_ptr<ThreadBuffer> buffer = it->second.lock();
+			if (buffer != nullptr)
+				return buffer;
+		}
+
+		/// Forget the buffers of the destroied recorders.
+		for (auto old = threadBuffers.begin(); old != threadBuffers.end();)
+		{
+			if (old->second.expired())
+				old = threadBuffers.erase(old);
+			else
+				++old;
+		}
+
+		std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+		threadBuffers[m_id] = buffer;
+
+		std::lock_guard<std::mutex> lock(m_buffersMutex);
+		m_buffers.push_back(buffer);
+		return buffer;
+	}
+
+	int TraceRecorder::ComputeGoalDistanceEstimate(unsigned int goalIndex, unsigned int nodeIndex)
+	{
+		auto navMesh = m_navMesh.lock();
+		if (navMesh == nullptr)
+			return 0;
+
+		int estimate = navMesh->ComputeGoalDistanceEstimate(goalIndex, nodeIndex);
+
+		/// If the same question is asked again, the first answer is kept.
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		buffer->m_trace.m_estimates.insert(std::make_pair(Trace::GetKey(goalIndex, nodeIndex), estimate));
+
+		return estimate;
+	}
+
+	int TraceRecorder::ComputeCost(unsigned int nodeIndex, unsigned int neighborIndex)
+	{
+		auto navMesh = m_navMesh.lock();
+		if (navMesh == nullptr)
+			return 0;
+
+		int cost = navMesh->ComputeCost(nodeIndex, neighborIndex);
+
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		buffer->m_trace.m_costs.insert(std::make_pair(Trace::GetKey(nodeIndex, neighborIndex), cost));
+
+		return cost;
+	}
+
+	std::vector<unsigned int> TraceRecorder::GetNeighbors(unsigned int nodeIndex)
+	{
+		auto navMesh = m_navMesh.lock();
+		if (navMesh == nullptr)
+			return std::vector<unsigned int>();
+
+		std::vector<unsigned int> neighbors = navMesh->GetNeighbors(nodeIndex);
+
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		buffer->m_trace.m_neighbors.insert(std::make_pair(nodeIndex, neighbors));
+
+		return neighbors;
+	}
+
+	bool TraceRecorder::HasLineOfSight(unsigned int fromIndex, unsigned int toIndex)
+	{
+		auto navMesh = m_navMesh.lock();
+		if (navMesh == nullptr)
+			return false;
+
+		bool lineOfSight = navMesh->HasLineOfSight(fromIndex, toIndex);
+
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		buffer->m_trace.m_linesOfSight.insert(std::make_pair(Trace::GetKey(fromIndex, toIndex), lineOfSight ? 1 : 0));
+
+		return lineOfSight;
+	}
+
+	bool TraceRecorder::GetNodePosition(unsigned int nodeIndex, std::array<float, 3>& position)
+	{
+		auto navMesh = m_navMesh.lock();
+		if (navMesh == nullptr)
+			return false;
+
+		Trace::PositionRecord record;
+		record.m_position.fill(0);
+		record.m_known = navMesh->GetNodePosition(nodeIndex, record.m_position);
+		if (record.m_known)
+			position = record.m_position;
+
+		auto buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer->m_mutex);
+		buffer->m_trace.m_positions.insert(std::make_pair(nodeIndex, record));
+
+		return record.m_known;
+	}
+
+	void TraceRecorder::AddTicket(std::shared_ptr<FindPathEngine> engine, std::shared_ptr<Ticket> ticket)
+	{
+		Trace::TicketRecord record;
+		record.m_time = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+		record.m_startIndex = ticket->GetStartIndex();
+		record.m_goalIndex = ticket->GetGoalIndex();
+		record.m_runAsync = ticket->GetRunAsync();
+		record.m_runParallel = ticket->GetRunParallel();
+
+		record.m_agentId = 0;
+		record.m_startTime = 0;
+		record.m_window = 0;
+		record.m_waitCost = 0;
+		record.m_cooperative = ticket->GetCooperative(record.m_agentId, record.m_startTime, record.m_window, record.m_waitCost);
+
+		record.m_stringPulling = false;
+		record.m_removeCollinear = false;
+		record.m_encodeWaypoints = false;
+		record.m_postProcess = ticket->GetPostProcess(record.m_stringPulling, record.m_removeCollinear, record.m_encodeWaypoints);
+
+		{
+			auto buffer = GetThreadBuffer();
+			std::lock_guard<std::mutex> lock(buffer->m_mutex);
+			buffer->m_trace.m_tickets.push_back(record);
+			buffer->m_ticketsOrder.push_back(m_ticketsCount++);
+		}
+
+		engine->AddTicket(ticket);
+	}
+
+	bool TraceRecorder::Save(const std::string& fileName)
+	{
+		Trace trace;
+		std::vector<std::pair<uint64_t, Trace::TicketRecord> > tickets;
+
+		{
+			std::lock_guard<std::mutex> lockBuffers(m_buffersMutex);
+			for (auto& buffer : m_buffers)
+			{
+				/// The threads can ask the same question. The first answer merged is kept.
+				std::lock_guard<std::mutex> lock(buffer->m_mutex);
+				trace.m_neighbors.insert(buffer->m_trace.m_neighbors.begin(), buffer->m_trace.m_neighbors.end());
+				trace.m_costs.insert(buffer->m_trace.m_costs.begin(), buffer->m_trace.m_costs.end());
+				trace.m_estimates.insert(buffer->m_trace.m_estimates.begin(), buffer->m_trace.m_estimates.end());
+				trace.m_linesOfSight.insert(buffer->m_trace.m_linesOfSight.begin(), buffer->m_trace.m_linesOfSight.end());
+				trace.m_positions.insert(buffer->m_trace.m_positions.begin(), buffer->m_trace.m_positions.end());
+
+				for (size_t i = 0; i < buffer->m_trace.m_tickets.size(); i++)
+				{
+					tickets.push_back(std::make_pair(buffer->m_ticketsOrder[i], buffer->m_trace.m_tickets[i]));
+				}
+			}
+		}
+
+		/// Put the tickets back in the order they were added.
+		std::sort(tickets.begin(), tickets.end(),
+			[](const std::pair<uint64_t, Trace::TicketRecord>& a, const std::pair<uint64_t, Trace::TicketRecord>& b)
+			{
+				return a.first < b.first;
+			});
+
+		trace.m_tickets.reserve(tickets.size());
+		for (auto& ticket : tickets)
+		{
+			trace.m_tickets.push_back(ticket.second);
+		}
+
+		return trace.Save(fileName);
+	}
+} //namespace fpe
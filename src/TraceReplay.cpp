@@ -0,0 +1,263 @@
+
+#include "FindPathEngine/TraceReplay.h"
+#include "FindPathEngine/ReservationTable.h"
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <iomanip>
+#include <atomic>
+#include <deque>
+
+
+namespace fpe
+{
+	/** This is the navmesh used by the replay. The answers are taken from the trace.
+	* The questions that were not recorded have no neighbors and cost 0, and are counted
+	* as misses: then the replay does not do the recorded work.*/
+	class TraceNavMesh : public NavMeshBase
+	{
+	public:
+		TraceNavMesh(std::shared_ptr<Trace> trace)
+			: m_trace(trace)
+			, m_missesCount(0)
+		{
+		}
+
+		int ComputeGoalDistanceEstimate(unsigned int goalIndex, unsigned int nodeIndex) override
+		{
+			auto it = m_trace->m_estimates.find(Trace::GetKey(goalIndex, nodeIndex));
+			if (it != m_trace->m_estimates.end())
+				return it->second;
+
+			m_missesCount++;
+			return 0;
+		}
+
+		int ComputeCost(unsigned int nodeIndex, unsigned int neighborIndex) override
+		{
+			auto it = m_trace->m_costs.find(Trace::GetKey(nodeIndex, neighborIndex));
+			if (it != m_trace->m_costs.end())
+				return it->second;
+
+			m_missesCount++;
+			return 0;
+		}
+
+		std::vector<unsigned int> GetNeighbors(unsigned int nodeIndex) override
+		{
+			auto it = m_trace->m_neighbors.find(nodeIndex);
+			if (it != m_trace->m_neighbors.end())
+				return it->second;
+
+			m_missesCount++;
+			return std::vector<unsigned int>();
+		}
+
+		bool HasLineOfSight(unsigned int fromIndex, unsigned int toIndex) override
+		{
+			auto it = m_trace->m_linesOfSight.find(Trace::GetKey(fromIndex, toIndex));
+			if (it != m_trace->m_linesOfSight.end())
+				return it->second != 0;
+
+			m_missesCount++;
+			return false;
+		}
+
+		bool GetNodePosition(unsigned int nodeIndex, std::array<float, 3>& position) override
+		{
+			auto it = m_trace->m_positions.find(nodeIndex);
+			if (it == m_trace->m_positions.end())
+			{
+				m_missesCount++;
+				return false;
+			}
+
+			if (it->second.m_known)
+				position = it->second.m_position;
+			return it->second.m_known;
+		}
+
+		/** Getter for the number of questions that were not in the trace */
+		unsigned int GetMissesCount() const { return m_missesCount; }
+
+	private:
+		/** Is only read, so all the threads can use it at a time. */
+		std::shared_ptr<Trace> m_trace;
+
+		/** Is increased by all the threads of the engine */
+		std::atomic<unsigned int> m_missesCount;
+	};
+
+
+	TraceReplay::TraceReplay()
+		: m_trace(std::make_shared<Trace>())
+	{
+	}
+
+	bool TraceReplay::Load(const std::string& fileName)
+	{
+		return m_trace->Load(fileName);
+	}
+
+	TraceReplay::Report TraceReplay::Run(unsigned int threadsCount, bool keepArrivalTimes, std::function<void(std::shared_ptr<FindPathEngine>)> setup)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		Report report;
+		report.m_threadsCount = threadsCount;
+		report.m_ticketsCount = (unsigned int)m_trace->m_tickets.size();
+		report.m_completedCount = 0;
+		report.m_stoppedCount = 0;
+		report.m_steps = 0;
+		report.m_missesCount = 0;
+		report.m_totalTime = 0;
+		report.m_minLatency = 0;
+		report.m_averageLatency = 0;
+		report.m_medianLatency = 0;
+		report.m_p95Latency = 0;
+		report.m_maxLatency = 0;
+
+		std::shared_ptr<TraceNavMesh> navMesh = std::make_shared<TraceNavMesh>(m_trace);
+		std::shared_ptr<FindPathEngine> engine = std::make_shared<FindPathEngine>(navMesh, threadsCount);
+
+		/// The cooperative tickets plan around each other in a new table.
+		std::shared_ptr<ReservationTable> reservations = std::make_shared<ReservationTable>();
+		engine->SetReservationTable(reservations);
+
+		if (setup != nullptr)
+			setup(engine);
+		const unsigned int setupMissesCount = navMesh->GetMissesCount();
+
+		/// The tickets added and not seen done, with the time they were added.
+		std::vector<std::pair<std::shared_ptr<Ticket>, Clock::time_point> > pending;
+		std::vector<double> latencies;
+		latencies.reserve(m_trace->m_tickets.size());
+
+		/// The cooperative tickets that arrived, but wait the ones before them. Only one is processed at a time,
+		/// because each one must plan around the reservations of all the tickets before it.
+		std::deque<std::pair<std::shared_ptr<Ticket>, unsigned int> > cooperativeWaiting;
+		std::shared_ptr<Ticket> cooperativeTicket = nullptr;
+
+		const Clock::time_point start = Clock::now();
+		size_t next = 0;
+
+		while ((next < m_trace->m_tickets.size()) || !pending.empty() || !cooperativeWaiting.empty())
+		{
+			/// Add the tickets that arrived until now.
+			uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+			while ((next < m_trace->m_tickets.size()) && (!keepArrivalTimes || (m_trace->m_tickets[next].m_time <= elapsed)))
+			{
+				const Trace::TicketRecord& record = m_trace->m_tickets[next++];
+
+				std::shared_ptr<Ticket> ticket = std::make_shared<Ticket>(record.m_startIndex, record.m_goalIndex, record.m_runAsync, record.m_runParallel);
+				if (record.m_postProcess)
+					ticket->SetPostProcess(record.m_stringPulling, record.m_removeCollinear, record.m_encodeWaypoints);
+
+				if (record.m_cooperative)
+				{
+					ticket->SetCooperative(record.m_agentId, record.m_startTime, record.m_window, record.m_waitCost);
+					cooperativeWaiting.push_back(std::make_pair(ticket, record.m_startTime));
+					continue;
+				}
+
+				engine->AddTicket(ticket);
+				pending.push_back(std::make_pair(ticket, Clock::now()));
+			}
+
+			/// Add the next cooperative ticket when the one before it is done.
+			if (!cooperativeWaiting.empty() && ((cooperativeTicket == nullptr) ||
+				(cooperativeTicket->GetState() == Ticket::State::COMPLETED) || (cooperativeTicket->GetState() == Ticket::State::STOPPED)))
+			{
+				cooperativeTicket = cooperativeWaiting.front().first;
+
+				/// As the game does each time step, forget the past.
+				reservations->ReleaseBefore(cooperativeWaiting.front().second);
+				cooperativeWaiting.pop_front();
+
+				engine->AddTicket(cooperativeTicket);
+				pending.push_back(std::make_pair(cooperativeTicket, Clock::now()));
+			}
+
+			engine->Update();
+
+			/// Check which tickets are done.
+			bool anyDone = false;
+			Clock::time_point now = Clock::now();
+			for (auto it = pending.begin(); it != pending.end();)
+			{
+				Ticket::State state = it->first->GetState();
+				if ((state != Ticket::State::COMPLETED) && (state != Ticket::State::STOPPED))
+				{
+					++it;
+					continue;
+				}
+
+				if (state == Ticket::State::COMPLETED)
+					report.m_completedCount++;
+				else
+					report.m_stoppedCount++;
+
+				report.m_steps += it->first->GetSteps();
+				latencies.push_back(std::chrono::duration<double, std::milli>(now - it->second).count());
+				it = pending.erase(it);
+				anyDone = true;
+			}
+
+			if (pending.empty() && cooperativeWaiting.empty() && (next < m_trace->m_tickets.size()) && keepArrivalTimes)
+			{
+				/// Nothing to do until the next ticket arrives.
+				elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+				if (m_trace->m_tickets[next].m_time > elapsed)
+					std::this_thread::sleep_for(std::chrono::microseconds(m_trace->m_tickets[next].m_time - elapsed));
+			}
+			else if (!anyDone)
+			{
+				/// The tickets are processed on the pool. Let the threads work.
+				std::this_thread::yield();
+			}
+		}
+
+		report.m_totalTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		report.m_missesCount = navMesh->GetMissesCount() - setupMissesCount;
+
+		if (!latencies.empty())
+		{
+			std::sort(latencies.begin(), latencies.end());
+
+			double sum = 0;
+			for (auto& latency : latencies)
+			{
+				sum += latency;
+			}
+
+			report.m_minLatency = latencies.front();
+			report.m_averageLatency = sum / latencies.size();
+			report.m_medianLatency = latencies[latencies.size() / 2];
+			report.m_p95Latency = latencies[std::min(latencies.size() - 1, latencies.size() * 95 / 100)];
+			report.m_maxLatency = latencies.back();
+		}
+
+		return report;
+	}
+
+	void TraceReplay::Report::Print(std::ostream& stream) const
+	{
+		stream << std::fixed << std::setprecision(3)
+			<< "threads " << m_threadsCount
+			<< " tickets " << m_ticketsCount
+			<< " (completed " << m_completedCount << ", stopped " << m_stoppedCount << ")"
+			<< " steps " << m_steps
+			<< " misses " << m_missesCount
+			<< " total " << m_totalTime << " ms"
+			<< " latency min " << m_minLatency
+			<< " avg " << m_averageLatency
+			<< " median " << m_medianLatency
+			<< " p95 " << m_p95Latency
+			<< " max " << m_maxLatency << " ms"
+			<< std::endl;
+
+		if (m_missesCount > 0)
+			stream << "warning: " << m_missesCount << " navmesh questions were not in the trace, the replay is not the recorded workload" << std::endl;
+	}
+} //namespace fpe
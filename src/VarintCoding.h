@@ -0,0 +1,52 @@
+#ifndef VARINTCODING_H
+#define VARINTCODING_H
+
+#include <vector>
+#include <cstdint>
+
+
+namespace fpe
+{
+	/** These are internal helpers used to write the numbers in a compact form: 7 bits in each
+	* byte, the high bit tells that another byte follows. The small numbers use a single byte.*/
+
+	/** Map the signed numbers to unsigned ones, so the small negative numbers are small too:
+	* 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3 ...*/
+	inline uint64_t ZigZagEncode(int64_t value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	inline int64_t ZigZagDecode(uint64_t value)
+	{
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	inline void WriteVarint(std::vector<unsigned char>& buffer, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((unsigned char)value);
+	}
+
+	/** Read a number and move the position after it.
+	* @return false if the buffer ends before the number.*/
+	inline bool ReadVarint(const unsigned char*& position, const unsigned char* end, uint64_t& value)
+	{
+		value = 0;
+		for (unsigned int shift = 0; (position < end) && (shift < 64); shift += 7)
+		{
+			unsigned char byte = *position++;
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+} // namespace fpe
+
+#endif //VARINTCODING_H
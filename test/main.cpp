@@ -3,8 +3,20 @@
 
 //#include "MemoryLeaksTracker/MemoryLT.h"
 #include "FindPathEngine/FindPathEngine.h"
+#include "FindPathEngine/ContractionHierarchy.h"
+#include "FindPathEngine/StaticGraph.h"
+#include "FindPathEngine/Batch.h"
+#include "FindPathEngine/ReservationTable.h"
+#include "FindPathEngine/TraceRecorder.h"
+#include "FindPathEngine/TraceReplay.h"
+#include "FindPathEngine/PathPostProcess.h"
 
 #include <cmath>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
 
 
 class NavMesh : public fpe::NavMeshBase
@@ -119,6 +131,600 @@ std::vector<unsigned int> NavMesh::GetNeighbors(unsigned int nodeIndex)
 };
 
 
+/** A big grid with random walls, used to measure the contraction hierarchy.*/
+class GridNavMesh : public fpe::NavMeshBase
+{
+public:
+	static const unsigned int k_w = 200;
+	static const unsigned int k_h = 200;
+	static const unsigned int k_meshSize = k_w * k_h;
+
+	GridNavMesh()
+		: m_collisions(k_meshSize)
+	{
+		std::srand(1);
+		for (unsigned int i = 0; i < k_meshSize; i++)
+		{
+			/// 10% of the tiles are walls
+			m_collisions[i] = (std::rand() % 10) == 0;
+		}
+	}
+
+	int ComputeGoalDistanceEstimate(unsigned int goalIndex, unsigned int nodeIndex) override
+	{
+		int dx = std::abs(int(goalIndex % k_w) - int(nodeIndex % k_w));
+		int dy = std::abs(int(goalIndex / k_w) - int(nodeIndex / k_w));
+		return 10 * std::max(dx, dy) + 4 * std::min(dx, dy);
+	}
+
+	int ComputeCost(unsigned int nodeIndex, unsigned int neighborIndex) override
+	{
+		int dx = std::abs(int(neighborIndex % k_w) - int(nodeIndex % k_w));
+		int dy = std::abs(int(neighborIndex / k_w) - int(nodeIndex / k_w));
+		return ((dx + dy) >= 2) ? 14 : 10;
+	}
+
+	std::vector<unsigned int> GetNeighbors(unsigned int nodeIndex) override
+	{
+		std::vector<unsigned int> neighbors;
+		if (m_collisions[nodeIndex])
+			return neighbors;
+
+		int nodeX = nodeIndex % k_w;
+		int nodeY = nodeIndex / k_w;
+		for (int y = nodeY - 1; y <= nodeY + 1; y++)
+		{
+			for (int x = nodeX - 1; x <= nodeX + 1; x++)
+			{
+				if ((y < 0) || (y >= (int)k_h) || (x < 0) || (x >= (int)k_w) || ((x == nodeX) && (y == nodeY)))
+					continue;
+
+				unsigned int neighbor = y * k_w + x;
+				if (!m_collisions[neighbor])
+					neighbors.push_back(neighbor);
+			}
+		}
+		return neighbors;
+	}
+
+	bool HasLineOfSight(unsigned int fromIndex, unsigned int toIndex) override
+	{
+		int x = fromIndex % k_w;
+		int y = fromIndex / k_w;
+		int dx = std::abs(int(toIndex % k_w) - x);
+		int dy = std::abs(int(toIndex / k_w) - y);
+		int stepX = (int(toIndex % k_w) > x) ? 1 : -1;
+		int stepY = (int(toIndex / k_w) > y) ? 1 : -1;
+
+		/// Walk all the tiles crossed by the line between the tile centers.
+		int error = dx - dy;
+		for (int count = dx + dy + 1; count > 0; count--)
+		{
+			if (m_collisions[y * k_w + x])
+				return false;
+
+			if (error > 0)
+			{
+				x += stepX;
+				error -= 2 * dy;
+			}
+			else if (error < 0)
+			{
+				y += stepY;
+				error += 2 * dx;
+			}
+			else
+			{
+				/// The line pass exactly by a corner. Like in GetNeighbors(), the corner can be cut.
+				x += stepX;
+				y += stepY;
+				error += 2 * (dx - dy);
+				count--;
+			}
+		}
+		return true;
+	}
+
+	bool GetNodePosition(unsigned int nodeIndex, std::array<float, 3>& position) override
+	{
+		position[0] = float(nodeIndex % k_w);
+		position[1] = float(nodeIndex / k_w);
+		position[2] = 0;
+		return true;
+	}
+
+private:
+	std::vector<bool> m_collisions;
+};
+
+/** The hierarchy may add at most this many shortcuts for each original edge.*/
+static const double k_maxShortcutsPerEdge = 1.6;
+
+/** A query must be at least this many times faster than a one-to-all Dijkstra. The times are
+* compared, not measured alone, so the check does not depend on the machine.*/
+static const double k_minQuerySpeedup = 10.0;
+
+/** Compare the contraction hierarchy queries with a Dijkstra search on the same graph.
+* All the answers are checked against Dijkstra.
+* @return false if an answer is wrong, or if the hierarchy have too many shortcuts or is too slow.*/
+bool BenchmarkContractionHierarchy(unsigned int threadsCount)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::shared_ptr<GridNavMesh> navmesh = std::make_shared<GridNavMesh>();
+	std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(navmesh, threadsCount);
+
+	Clock::time_point buildStart = Clock::now();
+	std::shared_ptr<fpe::ContractionHierarchy> hierarchy = engine->ComputeContractionHierarchy(GridNavMesh::k_meshSize);
+	double buildTime = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+	fpe::StaticGraph graph;
+	graph.Build(navmesh, GridNavMesh::k_meshSize);
+
+	std::vector<int> distances;
+	std::vector<unsigned int> path;
+	double dijkstraTime = 0;
+	double queryTime = 0;
+	unsigned int dijkstraCount = 0;
+	unsigned int queryCount = 0;
+	bool valid = true;
+
+	std::srand(2);
+	for (unsigned int i = 0; i < 20; i++)
+	{
+		unsigned int start = std::rand() % GridNavMesh::k_meshSize;
+
+		Clock::time_point dijkstraStart = Clock::now();
+		graph.ComputeDistances(start, false, distances);
+		dijkstraTime += std::chrono::duration<double, std::micro>(Clock::now() - dijkstraStart).count();
+		dijkstraCount++;
+
+		for (unsigned int j = 0; j < 100; j++)
+		{
+			unsigned int goal = std::rand() % GridNavMesh::k_meshSize;
+
+			int cost = 0;
+			Clock::time_point queryStart = Clock::now();
+			bool found = hierarchy->FindPath(start, goal, path, cost);
+			queryTime += std::chrono::duration<double, std::micro>(Clock::now() - queryStart).count();
+			queryCount++;
+
+			if (found != (distances[goal] != fpe::StaticGraph::k_unreachable) || (found && (cost != distances[goal])))
+				valid = false;
+		}
+	}
+
+	const double shortcutsPerEdge = (double)hierarchy->GetShortcutsCount() / graph.m_forwardTargets.size();
+	const double speedup = (dijkstraTime / dijkstraCount) / (queryTime / queryCount);
+
+	std::cout << "contraction hierarchy " << GridNavMesh::k_w << "x" << GridNavMesh::k_h
+		<< ": build " << buildTime << " ms, " << hierarchy->GetShortcutsCount() << " shortcuts (" << shortcutsPerEdge << " per edge), "
+		<< "query " << (queryTime / queryCount) << " us, one-to-all dijkstra " << (dijkstraTime / dijkstraCount) << " us, "
+		<< (valid ? "all answers are correct" : "WRONG ANSWERS") << std::endl;
+
+	if (shortcutsPerEdge > k_maxShortcutsPerEdge)
+	{
+		std::cout << "contraction hierarchy: too many shortcuts, the budget is " << k_maxShortcutsPerEdge << " per edge" << std::endl;
+		valid = false;
+	}
+
+	if (speedup < k_minQuerySpeedup)
+	{
+		std::cout << "contraction hierarchy: the query is only " << speedup << " times faster than dijkstra, the budget is " << k_minQuerySpeedup << std::endl;
+		valid = false;
+	}
+
+	return valid;
+}
+
+/** Sum the costs of a path from goal to start (like Ticket::GetFoundPath()), and check that each
+* node is a neighbor of the node before it on the way from start.
+* @return the cost, or -1 if two nodes of the path are not neighbors.*/
+int ComputePathCost(fpe::NavMeshBase* navmesh, const std::vector<unsigned int>& path)
+{
+	int cost = 0;
+	for (size_t i = 1; i < path.size(); i++)
+	{
+		std::vector<unsigned int> neighbors = navmesh->GetNeighbors(path[i]);
+		if (std::find(neighbors.begin(), neighbors.end(), path[i - 1]) == neighbors.end())
+			return -1;
+
+		cost += navmesh->ComputeCost(path[i], path[i - 1]);
+	}
+	return cost;
+}
+
+/** Solve long tickets with the parallel search (HDA*) and check the paths against Dijkstra.
+* The jobs expand the nodes in any order, so check that the path found is still the shortest.
+* @return false if a path is wrong or is not the shortest.*/
+bool TestParallelTickets(unsigned int threadsCount)
+{
+	std::shared_ptr<GridNavMesh> navmesh = std::make_shared<GridNavMesh>();
+	std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(navmesh, threadsCount);
+
+	fpe::StaticGraph graph;
+	graph.Build(navmesh, GridNavMesh::k_meshSize);
+
+	std::vector<std::shared_ptr<fpe::Ticket> > tickets;
+	std::srand(3);
+	for (unsigned int i = 0; i < 20; i++)
+	{
+		unsigned int start = std::rand() % GridNavMesh::k_meshSize;
+		unsigned int goal = std::rand() % GridNavMesh::k_meshSize;
+		tickets.push_back(std::make_shared<fpe::Ticket>(start, goal, true, true));
+		engine->AddTicket(tickets.back());
+	}
+
+	while (!engine->Update())
+	{
+		std::this_thread::yield();
+	}
+
+	std::vector<int> distances;
+	unsigned int wrongCount = 0;
+	for (auto& ticket : tickets)
+	{
+		graph.ComputeDistances(ticket->GetStartIndex(), false, distances);
+		int distance = distances[ticket->GetGoalIndex()];
+
+		if (distance == fpe::StaticGraph::k_unreachable)
+		{
+			if (ticket->GetState() != fpe::Ticket::State::STOPPED)
+				wrongCount++;
+			continue;
+		}
+
+		std::vector<unsigned int>& path = ticket->GetFoundPath();
+		if ((ticket->GetState() != fpe::Ticket::State::COMPLETED) || path.empty() ||
+			(path.front() != ticket->GetGoalIndex()) || (path.back() != ticket->GetStartIndex()) ||
+			(ComputePathCost(navmesh.get(), path) != distance))
+		{
+			wrongCount++;
+		}
+	}
+
+	std::cout << "parallel tickets: " << tickets.size() << " tickets on " << threadsCount << " threads, "
+		<< (wrongCount == 0 ? "all paths are the shortest" : "WRONG PATHS") << std::endl;
+
+	return wrongCount == 0;
+}
+
+/** Solve a batch on the threads pool and check each result against Dijkstra: the status, the
+* place of the path in the buffer, the start and goal nodes, and the cost.
+* @return false if a result is wrong.*/
+bool TestBatch(unsigned int threadsCount)
+{
+	std::shared_ptr<GridNavMesh> navmesh = std::make_shared<GridNavMesh>();
+	std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(navmesh, threadsCount);
+
+	fpe::StaticGraph graph;
+	graph.Build(navmesh, GridNavMesh::k_meshSize);
+
+	std::vector<unsigned int> starts;
+	std::vector<unsigned int> goals;
+	std::srand(4);
+	for (unsigned int i = 0; i < 300; i++)
+	{
+		/// A few starts, so a Dijkstra search checks many requests.
+		starts.push_back((i / 30) * 4001);
+		goals.push_back(std::rand() % GridNavMesh::k_meshSize);
+	}
+
+	std::shared_ptr<fpe::Batch> batch = engine->AddBatch(starts, goals, 16);
+	batch->Wait();
+
+	const std::vector<unsigned int>& nodes = batch->GetPathNodes();
+	std::vector<int> distances;
+	unsigned int offset = 0;
+	unsigned int wrongCount = 0;
+	for (unsigned int i = 0; i < batch->GetCount(); i++)
+	{
+		if ((i == 0) || (starts[i] != starts[i - 1]))
+			graph.ComputeDistances(starts[i], false, distances);
+		int distance = distances[goals[i]];
+
+		/// The paths are in the order of the requests, one after another.
+		unsigned int length = batch->GetLengths()[i];
+		if ((batch->GetOffsets()[i] != offset) || (offset + length > nodes.size()))
+		{
+			wrongCount++;
+			break;
+		}
+		offset += length;
+
+		if (distance == fpe::StaticGraph::k_unreachable)
+		{
+			if (batch->GetStatuses()[i] != fpe::Batch::Status::NOT_FOUND)
+				wrongCount++;
+			continue;
+		}
+
+		/// The batch path is from start to goal.
+		std::vector<unsigned int> path(nodes.begin() + batch->GetOffsets()[i], nodes.begin() + batch->GetOffsets()[i] + length);
+		std::reverse(path.begin(), path.end());
+
+		if ((batch->GetStatuses()[i] != fpe::Batch::Status::FOUND) || path.empty() ||
+			(path.front() != goals[i]) || (path.back() != starts[i]) ||
+			(ComputePathCost(navmesh.get(), path) != distance))
+		{
+			wrongCount++;
+		}
+	}
+
+	if (offset != nodes.size())
+		wrongCount++;
+
+	std::cout << "batch: " << batch->GetCount() << " requests on " << threadsCount << " threads, " << nodes.size() << " nodes, "
+		<< (wrongCount == 0 ? "all results are correct" : "WRONG RESULTS") << std::endl;
+
+	return wrongCount == 0;
+}
+
+/** Move many agents with cooperative tickets (WHCA*) in a small part of the grid. Each agent
+* plans again every few steps, from the node where it is, like a game does.
+* @return false if two agents are on the same node at the same time, or if two agents swap their nodes.*/
+bool TestCooperativeAgents(unsigned int threadsCount)
+{
+	static const unsigned int k_areaSize = 20;
+	static const unsigned int k_agentsCount = 30;
+	static const unsigned int k_window = 16;
+	static const unsigned int k_replanSteps = 4;
+	static const unsigned int k_stepsCount = 80;
+
+	std::shared_ptr<GridNavMesh> navmesh = std::make_shared<GridNavMesh>();
+	std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(navmesh, threadsCount);
+	std::shared_ptr<fpe::ReservationTable> reservations = std::make_shared<fpe::ReservationTable>();
+	engine->SetReservationTable(reservations);
+
+	/// The agents start and stop on different free nodes of the area.
+	std::vector<unsigned int> positions;
+	std::vector<unsigned int> goals;
+	std::srand(5);
+	while (positions.size() < k_agentsCount)
+	{
+		unsigned int start = (std::rand() % k_areaSize) * GridNavMesh::k_w + (std::rand() % k_areaSize);
+		unsigned int goal = (std::rand() % k_areaSize) * GridNavMesh::k_w + (std::rand() % k_areaSize);
+		if (navmesh->GetNeighbors(start).empty() || navmesh->GetNeighbors(goal).empty() ||
+			(std::find(positions.begin(), positions.end(), start) != positions.end()))
+			continue;
+
+		positions.push_back(start);
+		goals.push_back(goal);
+	}
+
+	std::vector<std::vector<unsigned int> > plans(k_agentsCount);
+	unsigned int planTime = 0;
+	unsigned int stoppedCount = 0;
+	unsigned int collisionsCount = 0;
+	unsigned int swapsCount = 0;
+
+	for (unsigned int time = 0; time < k_stepsCount; time++)
+	{
+		if ((time % k_replanSteps) == 0)
+		{
+			reservations->ReleaseBefore(time);
+
+			std::vector<std::shared_ptr<fpe::Ticket> > tickets;
+			for (unsigned int agent = 0; agent < k_agentsCount; agent++)
+			{
+				tickets.push_back(std::make_shared<fpe::Ticket>(positions[agent], goals[agent], true));
+				tickets.back()->SetCooperative(agent, time, k_window, 10);
+				engine->AddTicket(tickets.back());
+			}
+
+			while (!engine->Update())
+			{
+				std::this_thread::yield();
+			}
+
+			for (unsigned int agent = 0; agent < k_agentsCount; agent++)
+			{
+				/// The path is from goal to start, with a node for each time step.
+				std::vector<unsigned int>& path = tickets[agent]->GetFoundPath();
+				if ((tickets[agent]->GetState() != fpe::Ticket::State::COMPLETED) || path.empty() || (path.back() != positions[agent]))
+				{
+					stoppedCount++;
+					plans[agent].assign(1, positions[agent]);
+					continue;
+				}
+				plans[agent].assign(path.rbegin(), path.rend());
+			}
+			planTime = time;
+		}
+
+		/// Move the agents one step. At the end of its path, an agent waits.
+		std::vector<unsigned int> previous = positions;
+		for (unsigned int agent = 0; agent < k_agentsCount; agent++)
+		{
+			positions[agent] = plans[agent][std::min<size_t>(time + 1 - planTime, plans[agent].size() - 1)];
+		}
+
+		for (unsigned int agent = 0; agent < k_agentsCount; agent++)
+		{
+			for (unsigned int other = agent + 1; other < k_agentsCount; other++)
+			{
+				if (positions[agent] == positions[other])
+					collisionsCount++;
+
+				if ((positions[agent] != previous[agent]) && (positions[agent] == previous[other]) && (positions[other] == previous[agent]))
+					swapsCount++;
+			}
+		}
+	}
+
+	unsigned int arrivedCount = 0;
+	for (unsigned int agent = 0; agent < k_agentsCount; agent++)
+	{
+		if (positions[agent] == goals[agent])
+			arrivedCount++;
+	}
+
+	std::cout << "cooperative agents: " << k_agentsCount << " agents, " << k_stepsCount << " steps on " << threadsCount << " threads, "
+		<< arrivedCount << " arrived, " << stoppedCount << " stopped tickets, " << collisionsCount << " collisions, " << swapsCount << " swaps" << std::endl;
+
+	return (stoppedCount == 0) && (collisionsCount == 0) && (swapsCount == 0);
+}
+
+/** Record a workload on the grid, save it, load it, then replay it twice.
+* The replays must do the recorded work (no misses, the same steps) and give the same report.
+* @return false if the trace cannot be saved or loaded, or if a replay differ.*/
+bool TestTraceReplay(unsigned int threadsCount)
+{
+	static const char* k_fileName = "test_workload.trace";
+
+	std::shared_ptr<GridNavMesh> navmesh = std::make_shared<GridNavMesh>();
+	std::shared_ptr<fpe::TraceRecorder> recorder = std::make_shared<fpe::TraceRecorder>(navmesh);
+	std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(recorder, threadsCount);
+	std::shared_ptr<fpe::ReservationTable> reservations = std::make_shared<fpe::ReservationTable>();
+	engine->SetReservationTable(reservations);
+
+	std::vector<std::shared_ptr<fpe::Ticket> > tickets;
+	std::srand(6);
+
+	/// Many tickets at once, so all the threads record at the same time.
+	for (unsigned int i = 0; i < 24; i++)
+	{
+		tickets.push_back(std::make_shared<fpe::Ticket>(std::rand() % GridNavMesh::k_meshSize, std::rand() % GridNavMesh::k_meshSize, (i % 4) != 0));
+		if ((i % 3) == 0)
+			tickets.back()->SetPostProcess(true, true, true);
+		recorder->AddTicket(engine, tickets.back());
+	}
+
+	while (!engine->Update())
+	{
+		std::this_thread::yield();
+	}
+
+	/// Some agents that plan one after another, for a few time steps.
+	for (unsigned int time = 0; time < 12; time += 4)
+	{
+		reservations->ReleaseBefore(time);
+		for (unsigned int agent = 0; agent < 8; agent++)
+		{
+			tickets.push_back(std::make_shared<fpe::Ticket>(agent * 3, agent * 2 * GridNavMesh::k_w + 10, true));
+			tickets.back()->SetCooperative(agent, time, 12, 10);
+			recorder->AddTicket(engine, tickets.back());
+
+			while (!engine->Update())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	unsigned int completedCount = 0;
+	long long steps = 0;
+	for (auto& ticket : tickets)
+	{
+		if (ticket->GetState() == fpe::Ticket::State::COMPLETED)
+			completedCount++;
+		steps += ticket->GetSteps();
+	}
+
+	if (!recorder->Save(k_fileName))
+	{
+		std::cout << "trace replay: cannot save " << k_fileName << std::endl;
+		return false;
+	}
+
+	fpe::TraceReplay replay;
+	bool loaded = replay.Load(k_fileName);
+	std::remove(k_fileName);
+	if (!loaded || (replay.GetTrace().m_tickets.size() != tickets.size()))
+	{
+		std::cout << "trace replay: cannot load " << k_fileName << std::endl;
+		return false;
+	}
+
+	fpe::TraceReplay::Report first = replay.Run(threadsCount, true);
+	fpe::TraceReplay::Report second = replay.Run(threadsCount, true);
+	first.Print(std::cout);
+	second.Print(std::cout);
+
+	bool valid = true;
+	for (auto& report : { first, second })
+	{
+		if ((report.m_ticketsCount != tickets.size()) || (report.m_completedCount != completedCount) ||
+			(report.m_steps != steps) || (report.m_missesCount != 0))
+			valid = false;
+	}
+
+	if ((first.m_completedCount != second.m_completedCount) || (first.m_stoppedCount != second.m_stoppedCount) || (first.m_steps != second.m_steps))
+		valid = false;
+
+	std::cout << "trace replay: " << tickets.size() << " tickets recorded, " << steps << " steps, "
+		<< (valid ? "the replays did the recorded work" : "THE REPLAYS DIFFER") << std::endl;
+
+	return valid;
+}
+
+/** Solve tickets with post process and check the waypoints: the start and the goal are kept, each
+* waypoint can see the next one, and the encoded waypoints are decoded back the same.
+* @return false if the waypoints are wrong.*/
+bool TestPathPostProcess(unsigned int threadsCount)
+{
+	std::shared_ptr<GridNavMesh> navmesh = std::make_shared<GridNavMesh>();
+	std::shared_ptr<fpe::FindPathEngine> engine = std::make_shared<fpe::FindPathEngine>(navmesh, threadsCount);
+
+	std::vector<std::shared_ptr<fpe::Ticket> > tickets;
+	std::srand(7);
+	for (unsigned int i = 0; i < 20; i++)
+	{
+		tickets.push_back(std::make_shared<fpe::Ticket>(std::rand() % GridNavMesh::k_meshSize, std::rand() % GridNavMesh::k_meshSize, true));
+		tickets.back()->SetPostProcess(true, true, true);
+		engine->AddTicket(tickets.back());
+	}
+
+	while (!engine->Update())
+	{
+		std::this_thread::yield();
+	}
+
+	unsigned int wrongCount = 0;
+	size_t nodesCount = 0;
+	size_t waypointsCount = 0;
+	size_t bytesCount = 0;
+	std::vector<unsigned int> decoded;
+	std::vector<unsigned char> encoded;
+	for (auto& ticket : tickets)
+	{
+		if (ticket->GetState() != fpe::Ticket::State::COMPLETED)
+			continue;
+
+		/// The waypoints are from start to goal.
+		std::vector<unsigned int>& waypoints = ticket->GetWaypoints();
+		if (waypoints.empty() || (waypoints.front() != ticket->GetStartIndex()) || (waypoints.back() != ticket->GetGoalIndex()) ||
+			(waypoints.size() > ticket->GetFoundPath().size()))
+		{
+			wrongCount++;
+			continue;
+		}
+
+		for (size_t i = 1; i < waypoints.size(); i++)
+		{
+			if (!navmesh->HasLineOfSight(waypoints[i - 1], waypoints[i]))
+				wrongCount++;
+		}
+
+		if (!fpe::PathPostProcess::DecodeWaypoints(ticket->GetEncodedWaypoints(), decoded) || (decoded != waypoints))
+			wrongCount++;
+
+		nodesCount += ticket->GetFoundPath().size();
+		waypointsCount += waypoints.size();
+		bytesCount += ticket->GetEncodedWaypoints().size();
+	}
+
+	/// The nodes can go back and forth, and be far one from another.
+	std::vector<unsigned int> nodes = { 0, 5, 5, 39999, 1, 0xFFFFFFFF, 0, 200, 199 };
+	fpe::PathPostProcess::EncodeWaypoints(nodes, encoded);
+	if (!fpe::PathPostProcess::DecodeWaypoints(encoded, decoded) || (decoded != nodes))
+		wrongCount++;
+
+	std::cout << "path post process: " << nodesCount << " nodes, " << waypointsCount << " waypoints, " << bytesCount << " bytes encoded, "
+		<< (wrongCount == 0 ? "all waypoints are correct" : "WRONG WAYPOINTS") << std::endl;
+
+	return wrongCount == 0;
+}
 
 
 int main(int argc, char* argv[])
@@ -144,6 +750,23 @@ int main(int argc, char* argv[])
 		std::cout << "result " << nodeIndex << " " << (nodeIndex % NavMesh::k_w) << "x" << (nodeIndex / NavMesh::k_w) << std::endl;
 	}
 	
+	if (!BenchmarkContractionHierarchy(4))
+		return 1;
+
+	if (!TestParallelTickets(4))
+		return 1;
+
+	if (!TestBatch(4))
+		return 1;
+
+	if (!TestCooperativeAgents(4))
+		return 1;
+
+	if (!TestTraceReplay(4))
+		return 1;
+
+	if (!TestPathPostProcess(4))
+		return 1;
 
 	return 0;
 }